@@ -0,0 +1,77 @@
+#ifndef NATIVE_SHIM_ARDUINO_H
+#define NATIVE_SHIM_ARDUINO_H
+
+/*
+  Stand-in for the parts of the Arduino core the firmware uses, so it
+  can be built and run on a POSIX host ([env:native] in platformio.ini).
+  Time comes from the host's monotonic clock, pins read high (the
+  pull-ups) unless a test or the command line holds them low, analog
+  inputs read noise, and the serial port prints to stdout.  Functions
+  starting with "native" are not part of the Arduino API; they let
+  tests and tools drive the simulated hardware.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+int analogRead(uint8_t pin);
+
+class NativeSerial {
+ public:
+  void begin(long baud);
+  int available();
+  int read();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *data, size_t length);
+  void flush();
+
+  void print(const char *s);
+  void print(char c);
+  void print(unsigned char n);
+  void print(int n);
+  void print(unsigned int n);
+  void print(long n);
+  void print(unsigned long n);
+  void println();
+  template<typename T> void println(T value) {
+    print(value);
+    println();
+  }
+};
+
+extern NativeSerial Serial;
+
+/*
+  These functions set the level a pin reads while it is an input,
+  queue bytes for Serial to receive, and make everything Serial sends
+  go to a buffer that nativeSerialTake() empties instead of stdout.
+*/
+void nativeSetPin(uint8_t pin, uint8_t level);
+void nativeSerialReceive(const uint8_t *data, size_t length);
+void nativeSerialCapture(unsigned char capture);
+size_t nativeSerialTake(uint8_t *data, size_t max);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef NATIVE_SHIM_EEPROM_H
+#define NATIVE_SHIM_EEPROM_H
+
+/*
+  Stand-in for the Arduino EEPROM library: the 1 KB EEPROM of the Uno,
+  erased (all 0xFF) at startup.  It is kept in memory unless
+  nativeEepromFile() names a file to keep it in, so that it survives
+  restarting the program the way the real EEPROM survives a power cut.
+*/
+
+#include <Arduino.h>
+
+class EEPROMClass {
+ public:
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length() { return 1024; }
+};
+
+extern EEPROMClass EEPROM;
+
+/*
+  This function loads the EEPROM from path (if the file exists) and
+  makes every later write go to the file as well.
+*/
+void nativeEepromFile(const char *path);
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef NATIVE_SHIM_FASTLED_H
+#define NATIVE_SHIM_FASTLED_H
+
+/*
+  Stand-in for the parts of FastLED the firmware uses, for the native
+  build.  The color math matches FastLED's; FastLED.show() does not
+  drive any hardware, it counts the frame and hands it to
+  nativeShowHook if one is set, which is how tests look at what would
+  have been sent to the strip.
+*/
+
+#include <Arduino.h>
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t red;
+      uint8_t green;
+      uint8_t blue;
+    };
+    struct {
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+    };
+    uint8_t raw[3];
+  };
+
+  CRGB() {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : red(ir), green(ig), blue(ib) {}
+  CRGB(uint32_t colorcode) : red(colorcode >> 16), green(colorcode >> 8), blue(colorcode) {}
+
+  uint8_t &operator[](uint8_t x) { return raw[x]; }
+  const uint8_t &operator[](uint8_t x) const { return raw[x]; }
+};
+
+inline bool operator==(const CRGB &lhs, const CRGB &rhs) {
+  return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b;
+}
+
+inline bool operator!=(const CRGB &lhs, const CRGB &rhs) {
+  return !(lhs == rhs);
+}
+
+enum LEDColorCorrection {
+  TypicalLEDStrip = 0xFFB0F0,
+  UncorrectedColor = 0xFFFFFF
+};
+
+#define DISABLE_DITHER 0x00
+#define BINARY_DITHER 0x01
+
+enum ESPIChipsets { LPD8806, WS2801, WS2803, SM16716, P9813, APA102, SK9822, DOTSTAR };
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+  return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  unsigned int t = i + j;
+  return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+  return i > j ? i - j : 0;
+}
+
+inline CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay) {
+  if (amountOfOverlay == 0) {
+    return existing;
+  }
+  if (amountOfOverlay == 255) {
+    existing = overlay;
+    return existing;
+  }
+  fract8 amountOfKeep = 255 - amountOfOverlay;
+  for (uint8_t c = 0; c < 3; c++) {
+    existing[c] = scale8(existing[c], amountOfKeep) + scale8(overlay[c], amountOfOverlay);
+  }
+  return existing;
+}
+
+class CFastLED {
+ public:
+  template<ESPIChipsets CHIPSET, uint8_t DATA_PIN, uint8_t CLOCK_PIN, EOrder RGB_ORDER>
+  void addLeds(CRGB *data, int nLedsOrOffset) {
+    ledData = data;
+    numLeds = nLedsOrOffset;
+  }
+
+  void setBrightness(uint8_t scale) { brightness = scale; }
+  uint8_t getBrightness() { return brightness; }
+  void setCorrection(const CRGB &correction) { (void)correction; }
+  void setDither(uint8_t ditherMode) { (void)ditherMode; }
+  void show();
+
+  CRGB *leds() { return ledData; }
+  int size() { return numLeds; }
+
+ private:
+  CRGB *ledData = NULL;
+  int numLeds = 0;
+  uint8_t brightness = 255;
+};
+
+extern CFastLED FastLED;
+
+// runs the statement that follows at most once every n milliseconds
+class CEveryNMillis {
+ public:
+  CEveryNMillis(unsigned long period) : period(period), last(millis()) {}
+  operator bool() {
+    unsigned long now = millis();
+    if (now - last < period) {
+      return false;
+    }
+    last = now;
+    return true;
+  }
+
+ private:
+  unsigned long period;
+  unsigned long last;
+};
+
+#define NATIVE_CONCAT2(a, b) a##b
+#define NATIVE_CONCAT(a, b) NATIVE_CONCAT2(a, b)
+#define EVERY_N_MILLISECONDS(n) \
+  static CEveryNMillis NATIVE_CONCAT(everyNMillis, __LINE__)(n); \
+  if (NATIVE_CONCAT(everyNMillis, __LINE__))
+
+/*
+  If set, FastLED.show() calls this with the frame it would send and
+  the brightness it would send it with.  nativeFramesShown counts the
+  calls to FastLED.show().
+*/
+extern void (*nativeShowHook)(const CRGB leds[], int numLeds, uint8_t brightness);
+extern unsigned long nativeFramesShown;
+
+#endif
@@ -0,0 +1,275 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include "EEPROM.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+
+NativeSerial Serial;
+CFastLED FastLED;
+EEPROMClass EEPROM;
+
+void (*nativeShowHook)(const CRGB leds[], int numLeds, uint8_t brightness) = NULL;
+unsigned long nativeFramesShown = 0;
+
+static uint8_t pinGrounded[64];  // inputs read high (pulled up) unless set here
+static std::deque<uint8_t> serialInput;
+static std::vector<uint8_t> serialOutput;
+static unsigned char serialCaptured = 0;
+static uint8_t eeprom[1024];
+static unsigned char eepromErased = 0;
+static FILE *eepromFile = NULL;
+
+
+// Helper function that returns the time on the host's monotonic clock
+// in microseconds.
+static unsigned long long clockMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// like on the board, time starts when the program does
+static const unsigned long long bootMicros = clockMicros();
+
+
+unsigned long millis() {
+  return (clockMicros() - bootMicros) / 1000;
+}
+
+
+unsigned long micros() {
+  return clockMicros() - bootMicros;
+}
+
+
+void delay(unsigned long ms) {
+  struct timespec duration = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+  nanosleep(&duration, NULL);
+}
+
+
+void delayMicroseconds(unsigned int us) {
+  struct timespec duration = { 0, (long)us * 1000 };
+  nanosleep(&duration, NULL);
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+
+int digitalRead(uint8_t pin) {
+  return pin < sizeof(pinGrounded) && !pinGrounded[pin] ? HIGH : LOW;
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  nativeSetPin(pin, level);
+}
+
+
+int analogRead(uint8_t pin) {
+  // a floating input: a few bits of noise
+  (void)pin;
+  return 300 + (rand() & 0x3F);
+}
+
+
+void nativeSetPin(uint8_t pin, uint8_t level) {
+  if (pin < sizeof(pinGrounded)) {
+    pinGrounded[pin] = level == LOW;
+  }
+}
+
+
+void nativeSerialReceive(const uint8_t *data, size_t length) {
+  serialInput.insert(serialInput.end(), data, data + length);
+}
+
+
+void nativeSerialCapture(unsigned char capture) {
+  serialCaptured = capture;
+}
+
+
+size_t nativeSerialTake(uint8_t *data, size_t max) {
+  size_t n = serialOutput.size() < max ? serialOutput.size() : max;
+  memcpy(data, serialOutput.data(), n);
+  serialOutput.erase(serialOutput.begin(), serialOutput.begin() + n);
+  return n;
+}
+
+
+void NativeSerial::begin(long baud) {
+  (void)baud;
+}
+
+
+int NativeSerial::available() {
+  return serialInput.size();
+}
+
+
+int NativeSerial::read() {
+  if (serialInput.empty()) {
+    return -1;
+  }
+  uint8_t c = serialInput.front();
+  serialInput.pop_front();
+  return c;
+}
+
+
+size_t NativeSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+
+size_t NativeSerial::write(const uint8_t *data, size_t length) {
+  if (serialCaptured) {
+    serialOutput.insert(serialOutput.end(), data, data + length);
+  }
+  else {
+    fwrite(data, 1, length, stdout);
+  }
+  return length;
+}
+
+
+void NativeSerial::flush() {
+  fflush(stdout);
+}
+
+
+void NativeSerial::print(const char *s) {
+  write((const uint8_t *)s, strlen(s));
+}
+
+
+void NativeSerial::print(char c) {
+  write((uint8_t)c);
+}
+
+
+void NativeSerial::print(unsigned char n) {
+  print((unsigned long)n);
+}
+
+
+void NativeSerial::print(int n) {
+  print((long)n);
+}
+
+
+void NativeSerial::print(unsigned int n) {
+  print((unsigned long)n);
+}
+
+
+void NativeSerial::print(long n) {
+  char text[24];
+  snprintf(text, sizeof(text), "%ld", n);
+  print(text);
+}
+
+
+void NativeSerial::print(unsigned long n) {
+  char text[24];
+  snprintf(text, sizeof(text), "%lu", n);
+  print(text);
+}
+
+
+void NativeSerial::println() {
+  print("\r\n");
+}
+
+
+// Helper function that erases the EEPROM the first time it is used.
+static void eepromErase() {
+  if (!eepromErased) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    eepromErased = 1;
+  }
+}
+
+
+uint8_t EEPROMClass::read(int address) {
+  eepromErase();
+  return eeprom[address & (sizeof(eeprom) - 1)];
+}
+
+
+void EEPROMClass::write(int address, uint8_t value) {
+  eepromErase();
+  address &= sizeof(eeprom) - 1;
+  eeprom[address] = value;
+  if (eepromFile != NULL) {
+    fseek(eepromFile, address, SEEK_SET);
+    fputc(value, eepromFile);
+    fflush(eepromFile);
+  }
+}
+
+
+void EEPROMClass::update(int address, uint8_t value) {
+  if (read(address) != value) {
+    write(address, value);
+  }
+}
+
+
+void nativeEepromFile(const char *path) {
+  eepromErase();
+  eepromFile = fopen(path, "r+b");
+  if (eepromFile != NULL) {
+    if (fread(eeprom, 1, sizeof(eeprom), eepromFile) < sizeof(eeprom)) {
+      fprintf(stderr, "%s: short EEPROM image, the rest reads as erased\n", path);
+    }
+    return;
+  }
+  eepromFile = fopen(path, "w+b");
+  if (eepromFile == NULL) {
+    perror(path);
+    return;
+  }
+  fwrite(eeprom, 1, sizeof(eeprom), eepromFile);
+  fflush(eepromFile);
+}
+
+
+void CFastLED::show() {
+  nativeFramesShown++;
+  if (nativeShowHook != NULL) {
+    nativeShowHook(ledData, numLeds, brightness);
+  }
+}
+
+
+void setup();
+void loop();
+
+// Runs the sketch.  Arguments "--low PIN" hold an input pin low, for
+// example "--low 3" to ground the autocycle switch pin, and "--eeprom
+// FILE" keeps the EEPROM in FILE across runs.  Weak, so that unit tests
+// and other host programs can bring their own main().
+__attribute__((weak)) int main(int argc, char **argv) {
+  setvbuf(stdout, NULL, _IOLBF, 0);  // show each line as it is printed
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--low") == 0) {
+      nativeSetPin(atoi(argv[++i]), LOW);
+    }
+    else if (strcmp(argv[i], "--eeprom") == 0) {
+      nativeEepromFile(argv[++i]);
+    }
+  }
+  setup();
+  for (;;) {
+    loop();
+  }
+}
@@ -0,0 +1,275 @@
+#include <Arduino.h>
+#include "constants.h"
+#include "audio.h"
+
+// only built with AUDIO_REACTIVE, so the ADC interrupt and the ring
+// buffer cost nothing otherwise
+#ifdef AUDIO_REACTIVE
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#else
+#include <stdio.h>
+#endif
+
+// samples analyzed per Goertzel block; at ~9.6 kHz this is a new block
+// (and a new set of envelopes) roughly every 6.7 ms
+const unsigned char AUDIO_BLOCK_SIZE = 64;
+// ring buffer size, a power of two; it holds 13 ms of samples, so
+// audioUpdate() must be called at least that often (the main loop
+// calls it every frame) or samples are lost
+const unsigned char AUDIO_RING_SIZE = 128;
+
+// Goertzel coefficients, 2*cos(2*pi*k/AUDIO_BLOCK_SIZE) in Q14 fixed point,
+// for the bins k = 1, 4 and 12 (see AudioBand)
+const int goertzelCoeff[NUM_AUDIO_BANDS] = { 32610, 30274, 12540 };
+
+// signed, DC-free samples; written by audioAddSample() (from the ADC
+// interrupt on AVR) and read by audioUpdate().  The head and tail
+// count samples written and read, modulo 256, so head - tail is the
+// number of buffered samples; the slot of sample n is n % AUDIO_RING_SIZE.
+static volatile signed char ring[AUDIO_RING_SIZE];
+static volatile unsigned char ringHead = 0;  // number of the next sample to write
+static volatile unsigned char ringTail = 0;  // number of the next sample to read
+static volatile unsigned char ringOverrun = 0;  // set when a sample was dropped
+static int dcLevel = 512 << 4;  // running input average, 4 fractional bits
+
+static unsigned char envelope[NUM_AUDIO_BANDS];
+
+
+void audioAddSample(int sample) {
+  // track the bias voltage with a slow running average and remove it
+  dcLevel += ((sample << 4) - dcLevel) >> 6;
+  int x = (sample - (dcLevel >> 4)) >> 2;
+  if (x > 127) {
+    x = 127;
+  }
+  else if (x < -128) {
+    x = -128;
+  }
+  if ((unsigned char)(ringHead - ringTail) >= AUDIO_RING_SIZE) {
+    // full: keep the unread samples intact and drop this one
+    ringOverrun = 1;
+    return;
+  }
+  ring[ringHead & (AUDIO_RING_SIZE - 1)] = x;
+  ringHead++;
+}
+
+
+#ifdef __AVR__
+ISR(ADC_vect) {
+  int sample = ADCL;  // ADCL must be read before ADCH
+  sample |= ADCH << 8;
+  audioAddSample(sample);
+}
+#else
+
+// the native build takes its input from a WAV file (see audioBegin())
+static uint16_t *wavSamples = NULL;
+static unsigned long wavLength = 0;
+static unsigned long wavStartMicros = 0;
+static unsigned long wavFed = 0;  // samples passed to audioAddSample()
+
+
+// Helper function that reads a little-endian number of the given
+// number of bytes.
+static unsigned long wavNumber(const uint8_t *bytes, unsigned char size) {
+  unsigned long value = 0;
+  for (unsigned char i = 0; i < size; i++) {
+    value |= (unsigned long)bytes[i] << (8*i);
+  }
+  return value;
+}
+
+
+unsigned long audioReadWav(const char *path, const uint16_t **samples) {
+  free(wavSamples);
+  wavSamples = NULL;
+  wavLength = 0;
+  *samples = NULL;
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return 0;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *bytes = (uint8_t *)malloc(size > 0 ? size : 1);
+  size = fread(bytes, 1, size, file);
+  fclose(file);
+
+  unsigned int channels = 0;
+  unsigned long rate = 0;
+  unsigned int bits = 0;
+  const uint8_t *data = NULL;
+  unsigned long dataSize = 0;
+  if (size >= 12 && memcmp(bytes, "RIFF", 4) == 0 && memcmp(bytes + 8, "WAVE", 4) == 0) {
+    // walk the chunks for the format and the sample data
+    long offset = 12;
+    while (offset + 8 <= size) {
+      unsigned long chunkSize = wavNumber(bytes + offset + 4, 4);
+      const uint8_t *chunk = bytes + offset + 8;
+      if (chunkSize > (unsigned long)(size - offset - 8)) {
+        chunkSize = size - offset - 8;  // truncated file: use what is there
+      }
+      if (memcmp(bytes + offset, "fmt ", 4) == 0 && chunkSize >= 16 && wavNumber(chunk, 2) == 1) {
+        channels = wavNumber(chunk + 2, 2);
+        rate = wavNumber(chunk + 4, 4);
+        bits = wavNumber(chunk + 14, 2);
+      }
+      else if (memcmp(bytes + offset, "data", 4) == 0) {
+        data = chunk;
+        dataSize = chunkSize;
+      }
+      offset += 8 + chunkSize + (chunkSize & 1);
+    }
+  }
+  if (data == NULL || channels == 0 || rate == 0 || (bits != 8 && bits != 16)) {
+    free(bytes);
+    return 0;  // not a PCM WAV file with 8- or 16-bit samples
+  }
+
+  // resample (nearest sample) to the ADC rate, mix the channels and
+  // scale to the ADC's 10 bits, centered on 512 like the biased input
+  unsigned int frameSize = channels * bits / 8;
+  unsigned long frames = dataSize / frameSize;
+  wavLength = (unsigned long long)frames * AUDIO_SAMPLE_RATE / rate;
+  wavSamples = (uint16_t *)malloc(wavLength * sizeof(uint16_t) + 1);
+  for (unsigned long n = 0; n < wavLength; n++) {
+    const uint8_t *frame = data + (unsigned long long)n * rate / AUDIO_SAMPLE_RATE * frameSize;
+    long sum = 0;
+    for (unsigned int c = 0; c < channels; c++) {
+      if (bits == 16) {
+        sum += (int16_t)wavNumber(frame + 2*c, 2) + 32768;
+      }
+      else {
+        sum += frame[c] << 8;
+      }
+    }
+    wavSamples[n] = (sum / channels) >> 6;
+  }
+  free(bytes);
+  *samples = wavSamples;
+  return wavLength;
+}
+
+
+// Helper function that passes the samples the ADC would have taken
+// since audioBegin() to audioAddSample(), playing the WAV file in a loop.
+static void audioFeedWav() {
+  if (wavLength == 0) {
+    return;
+  }
+  unsigned long due = (unsigned long long)(micros() - wavStartMicros) * AUDIO_SAMPLE_RATE / 1000000;
+  while (wavFed < due) {
+    audioAddSample(wavSamples[wavFed % wavLength]);
+    wavFed++;
+  }
+}
+
+#endif
+
+
+void audioBegin(uint8_t pin) {
+  #ifdef __AVR__
+    // AVcc reference, selected channel, free-running mode with the
+    // /128 prescaler: 16 MHz / 128 / 13 cycles per conversion = 9615 Hz
+    ADMUX = _BV(REFS0) | (pin & 0x07);
+    ADCSRB = 0;
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE)
+      | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  #else
+    (void)pin;
+    const uint16_t *samples;
+    audioReadWav(AUDIO_WAV_FILE, &samples);
+    wavStartMicros = micros();
+    wavFed = 0;
+  #endif
+}
+
+
+// Helper function that converts a Goertzel power estimate into an
+// 8-bit level on a logarithmic scale: the top four bits are the
+// position of the highest set bit and the bottom four bits are the
+// next four bits of the power below it.
+static unsigned char powerToLevel(long power) {
+  if (power <= 0) {
+    return 0;
+  }
+  unsigned char msb = 0;
+  while ((power >> msb) > 1) {
+    msb++;
+  }
+  if (msb > 15) {
+    return 255;
+  }
+  unsigned char frac = msb >= 4 ? (power >> (msb - 4)) & 0x0F : (power << (4 - msb)) & 0x0F;
+  return (msb << 4) | frac;
+}
+
+
+// Helper function that analyzes the block of AUDIO_BLOCK_SIZE samples
+// at the tail of the ring and feeds the band levels into the envelope
+// followers.
+static void audioAnalyzeBlock() {
+  long s1[NUM_AUDIO_BANDS] = { 0 };
+  long s2[NUM_AUDIO_BANDS] = { 0 };
+  unsigned char tail = ringTail;
+  for (unsigned char n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+    int x = ring[tail & (AUDIO_RING_SIZE - 1)];
+    tail++;
+    for (unsigned char b = 0; b < NUM_AUDIO_BANDS; b++) {
+      long s0 = x + ((goertzelCoeff[b] * s1[b]) >> 14) - s2[b];
+      s2[b] = s1[b];
+      s1[b] = s0;
+    }
+  }
+  ringTail = tail;  // only now may the writer reuse the block's slots
+
+  for (unsigned char b = 0; b < NUM_AUDIO_BANDS; b++) {
+    // scale the filter state down so the power fits in 32 bits
+    long a = s1[b] >> 4;
+    long c = s2[b] >> 4;
+    long power = a*a + c*c - ((goertzelCoeff[b] * a) >> 14) * c;
+    unsigned char level = powerToLevel(power);
+
+    // envelope follower: fast attack, slow release
+    if (level > envelope[b]) {
+      envelope[b] += (level - envelope[b] + 1) >> 1;
+    }
+    else {
+      envelope[b] -= (envelope[b] - level + 15) >> 4;
+    }
+  }
+}
+
+
+unsigned char audioUpdate() {
+  #ifndef __AVR__
+    audioFeedWav();
+  #endif
+
+  if (ringOverrun) {
+    // samples were dropped, so the buffered ones end with a gap; throw
+    // them away rather than analyze a block with a jump in it
+    ringTail = ringHead;
+    ringOverrun = 0;
+    return 0;
+  }
+
+  unsigned char blocks = 0;
+  while ((unsigned char)(ringHead - ringTail) >= AUDIO_BLOCK_SIZE) {
+    audioAnalyzeBlock();
+    blocks++;
+  }
+  return blocks;
+}
+
+
+unsigned char audioEnvelope(unsigned char band) {
+  return envelope[band];
+}
+
+#endif
@@ -0,0 +1,62 @@
+#include <Arduino.h>
+
+const unsigned int AUDIO_SAMPLE_RATE = 9615;  // samples per second
+
+// frequency bands analyzed by audioUpdate()
+enum AudioBand {
+  AudioBass = 0,    // ~150 Hz
+  AudioMid = 1,     // ~600 Hz
+  AudioTreble = 2,  // ~1.8 kHz
+  NUM_AUDIO_BANDS = 3
+};
+
+/*
+  This function starts sampling the analog input pin at a fixed rate
+  of AUDIO_SAMPLE_RATE.  On AVR the ADC is put in free-running mode and
+  every conversion is pushed into the sample ring buffer from the ADC
+  interrupt, so analogRead() must not be used after calling it.
+  On other targets there is no ADC: the input is read from the WAV
+  file AUDIO_WAV_FILE, if there is one, and played in a loop in real
+  time, one sample per 1 / AUDIO_SAMPLE_RATE seconds, by
+  audioUpdate().  Without the file the input is silent.
+*/
+void audioBegin(uint8_t pin);
+
+/*
+  This function pushes one 10-bit sample (0 to 1023, centered around
+  512) into the sample ring buffer.  If the buffer is full (audioUpdate()
+  was not called for about 13 ms) the sample is dropped, and the next
+  audioUpdate() discards the buffered samples and starts over with new
+  ones, so that no block is analyzed across the gap.
+*/
+void audioAddSample(int sample);
+
+/*
+  This function analyzes every complete block of buffered samples
+  with a bank of fixed-point Goertzel filters (one per AudioBand) and
+  feeds the band levels into the envelope followers.  It returns the
+  number of blocks analyzed.  It is meant to be called once per main
+  loop; an 8 ms frame brings about 77 new samples, so most calls
+  analyze one block, and calls with no complete block cost nothing.
+*/
+unsigned char audioUpdate();
+
+/*
+  This function returns the current envelope of the given band, from
+  0 (silence) to 255 (loud).  The envelope follows rising levels
+  quickly and decays slowly, so it is suitable for directly driving
+  pattern parameters.
+*/
+unsigned char audioEnvelope(unsigned char band);
+
+/*
+  Native build only: this function reads a PCM WAV file with 8- or
+  16-bit samples, at any rate and with any number of channels, and
+  converts it into the 10-bit samples the ADC would have taken from
+  the biased signal at AUDIO_SAMPLE_RATE.  It returns the number of
+  samples and points *samples at them, or returns 0 if the file cannot
+  be read.  The samples stay valid until the next call.
+*/
+#ifndef __AVR__
+unsigned long audioReadWav(const char *path, const uint16_t **samples);
+#endif
@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include "constants.h"
+#include "checkpoint.h"
+
+#ifdef HAS_EEPROM
+#include <EEPROM.h>
+
+// slot layout: sequence number, pattern, loopCount (2 bytes), seed
+// (2 bytes), PRNG state (4 bytes), collision state, collision count
+// (2 bytes), pattern run (2 bytes), checksum
+const unsigned char CHECKPOINT_SLOT_SIZE = 16;
+
+static unsigned char nextSlot = 0;  // slot the next checkpoint goes to
+static unsigned char nextSequence = 0;  // sequence number of the next checkpoint
+static unsigned char pending[CHECKPOINT_SLOT_SIZE];
+static unsigned char pendingIndex = CHECKPOINT_SLOT_SIZE;  // next byte to write
+static int pendingAddr = 0;
+
+
+// Helper function that returns the checksum of a slot.  The offset
+// makes both a blank (all 0xFF) and an all-zero slot invalid.
+static unsigned char slotChecksum(const unsigned char *slot) {
+  unsigned char sum = 0xA5;
+  for (unsigned char i = 0; i < CHECKPOINT_SLOT_SIZE - 1; i++) {
+    sum += slot[i];
+  }
+  return sum;
+}
+
+
+unsigned char checkpointLoad(Checkpoint *cp) {
+  unsigned char slot[CHECKPOINT_SLOT_SIZE];
+  unsigned char found = 0;
+  unsigned char newest = 0;
+  unsigned char newestSequence = 0;
+
+  // the newest checkpoint is the valid slot with the highest sequence
+  // number; sequence numbers wrap around, but the ones in the ring
+  // never span more than CHECKPOINT_SLOTS values, so comparing their
+  // difference as a signed byte works
+  for (unsigned char s = 0; s < CHECKPOINT_SLOTS; s++) {
+    int addr = CHECKPOINT_EEPROM_ADDR + s * CHECKPOINT_SLOT_SIZE;
+    for (unsigned char i = 0; i < CHECKPOINT_SLOT_SIZE; i++) {
+      slot[i] = EEPROM.read(addr + i);
+    }
+    if (slot[CHECKPOINT_SLOT_SIZE - 1] != slotChecksum(slot)) {
+      continue;
+    }
+    if (!found || (signed char)(slot[0] - newestSequence) > 0) {
+      found = 1;
+      newest = s;
+      newestSequence = slot[0];
+    }
+  }
+
+  if (!found) {
+    return 0;
+  }
+
+  int addr = CHECKPOINT_EEPROM_ADDR + newest * CHECKPOINT_SLOT_SIZE;
+  for (unsigned char i = 0; i < CHECKPOINT_SLOT_SIZE; i++) {
+    slot[i] = EEPROM.read(addr + i);
+  }
+  cp->pattern = slot[1];
+  cp->loopCount = slot[2] | (slot[3] << 8);
+  cp->seed = slot[4] | (slot[5] << 8);
+  cp->prngState = slot[6] | ((uint32_t)slot[7] << 8)
+    | ((uint32_t)slot[8] << 16) | ((uint32_t)slot[9] << 24);
+  cp->collisionState = slot[10];
+  cp->collisionCount = slot[11] | (slot[12] << 8);
+  cp->patternRun = slot[13] | (slot[14] << 8);
+
+  nextSlot = (newest + 1) % CHECKPOINT_SLOTS;
+  nextSequence = newestSequence + 1;
+  return 1;
+}
+
+
+void checkpointSave(const Checkpoint *cp) {
+  pending[0] = nextSequence++;
+  pending[1] = cp->pattern;
+  pending[2] = cp->loopCount;
+  pending[3] = cp->loopCount >> 8;
+  pending[4] = cp->seed;
+  pending[5] = cp->seed >> 8;
+  pending[6] = cp->prngState;
+  pending[7] = cp->prngState >> 8;
+  pending[8] = cp->prngState >> 16;
+  pending[9] = cp->prngState >> 24;
+  pending[10] = cp->collisionState;
+  pending[11] = cp->collisionCount;
+  pending[12] = cp->collisionCount >> 8;
+  pending[13] = cp->patternRun;
+  pending[14] = cp->patternRun >> 8;
+  pending[CHECKPOINT_SLOT_SIZE - 1] = slotChecksum(pending);
+
+  pendingAddr = CHECKPOINT_EEPROM_ADDR + nextSlot * CHECKPOINT_SLOT_SIZE;
+  pendingIndex = 0;
+  nextSlot = (nextSlot + 1) % CHECKPOINT_SLOTS;
+}
+
+
+void checkpointPoll() {
+  if (pendingIndex < CHECKPOINT_SLOT_SIZE) {
+    EEPROM.update(pendingAddr + pendingIndex, pending[pendingIndex]);
+    pendingIndex++;
+  }
+}
+
+#else
+
+// without EEPROM there is nowhere to keep checkpoints
+unsigned char checkpointLoad(Checkpoint *cp) {
+  (void)cp;
+  return 0;
+}
+
+void checkpointSave(const Checkpoint *cp) {
+  (void)cp;
+}
+
+void checkpointPoll() {
+}
+
+#endif
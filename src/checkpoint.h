@@ -0,0 +1,44 @@
+#include <Arduino.h>
+
+// everything needed to resume the show from where it was, except what
+// was drawn on the strip: the colors array, and the registers and
+// palette of the Bytecode pattern's VM (src/vm.h).  Those 32 bytes
+// would make a slot three times as big, cutting the ring to 10 slots
+// and the EEPROM's life to a third.  A resumed Bytecode run starts
+// from cleared registers and palette, as every run does (see
+// vmReset()).  Programs that set their palette and registers each
+// frame, like the default one, resume exactly.  Programs that count
+// across frames in a register start counting again.
+struct Checkpoint {
+  unsigned char pattern;
+  unsigned int loopCount;
+  unsigned int seed;
+  uint32_t prngState;
+  unsigned char collisionState;
+  unsigned int collisionCount;
+  unsigned int patternRun;
+};
+
+/*
+  This function finds the newest valid checkpoint in the EEPROM ring
+  and copies it into cp, returning 1, or returns 0 if there is none
+  (for example on a new board).  It must be called once at startup
+  before checkpointSave(), since it also finds the slot to write next.
+*/
+unsigned char checkpointLoad(Checkpoint *cp);
+
+/*
+  This function queues cp to be written to the next slot of the ring.
+  Writing an EEPROM byte takes about 3.3 ms, so nothing is written
+  here; checkpointPoll() writes one byte per call instead, so the main
+  loop never waits on the EEPROM.  A checkpoint that is still being
+  written is replaced by the new one.
+*/
+void checkpointSave(const Checkpoint *cp);
+
+/*
+  This function writes the next byte of a queued checkpoint, if any.
+  The slot checksum is written last, so a checkpoint cut short by a
+  power loss reads back as invalid and the previous one is used.
+*/
+void checkpointPoll();
@@ -1,5 +1,19 @@
 #include <Arduino.h>
 
+#ifdef __AVR__
+#define HAS_EEPROM
+#endif
+
+// marks the variables that make up the state of a running show (the
+// pattern, its loop counter, the PRNG and the patterns' own state); on
+// the host each thread gets its own copy, so the offline renderer
+// (src/render.cpp) can render several parts of the show at once
+#ifdef __AVR__
+#define SHOW_STATE
+#else
+#define SHOW_STATE thread_local
+#endif
+
 // #define LED_TYPE APA102
 #define LED_TYPE SK9822
 #define COLOR_ORDER BGR
@@ -15,3 +29,72 @@ const uint8_t FRAMES_PER_SECOND = 120;
 
 const uint8_t NEXT_PATTERN_BUTTON_PIN = 2; // button between this pin and ground
 const uint8_t AUTOCYCLE_SWITCH_PIN = 3; // switch between this pin and ground
+
+// uncomment to modulate the patterns with music sampled on AUDIO_PIN
+// #define AUDIO_REACTIVE
+const uint8_t AUDIO_PIN = 0; // analog input, signal biased to half supply
+const char AUDIO_WAV_FILE[] = "audio.wav";  // read in place of AUDIO_PIN by the native build
+
+// uncomment to add a pattern that runs a bytecode program loaded from
+// EEPROM or received over the serial port (see src/vm.h and tools/vmasm.py)
+// #define BYTECODE_VM
+const long SERIAL_BAUD = 115200;
+const int VM_EEPROM_ADDR = 16;  // EEPROM address of the stored program
+const uint8_t VM_MAX_PROGRAM = 128;  // max program length in bytes
+// max cost of the instructions a program may run per frame, in steps
+// of about the simplest instruction (an estimated 3 us on a 16 MHz Uno,
+// so about 3 ms of the 8.3 ms frame; see vmRun())
+const unsigned int VM_STEP_LIMIT = 1000;
+const unsigned char VM_RX_TIMEOUT_MS = 50;  // max wait for the next byte of a program
+
+// uncomment to send the colors through the fused 16-bit output pass
+// (gamma, brightness, color correction and temporal dithering, see src/output.h);
+// Gradient and the fading patterns then render into a 16-bit buffer (360 more
+// bytes of RAM at 60 LEDs), and the gamma 2.2 curve makes every pattern's
+// middle levels darker than on the 8-bit path the patterns were tuned on
+// #define HIGH_PRECISION_OUTPUT
+
+// uncomment to print timing statistics on the serial port at every pattern change
+// #define REPORT_STATS
+
+// uncomment to scale down frames that would draw more than POWER_BUDGET_MA
+// (estimated from the channel values of each frame, see src/power.h)
+// #define POWER_LIMIT
+const unsigned int POWER_BUDGET_MA = 1500;
+const uint8_t MA_PER_CHANNEL = 20;  // draw of one channel at full brightness
+const uint8_t MA_IDLE_PER_LED = 1;  // draw of an LED that is off
+
+// uncomment to render exactly one frame per FRAME_PERIOD and idle-sleep the
+// MCU for the rest of it (see src/sleep.h); patterns then run slower and last longer
+// #define IDLE_SLEEP
+
+// uncomment to resume the show where it left off after a power cut,
+// from a checkpoint kept in a wear-leveled EEPROM ring (see src/checkpoint.h);
+// at one checkpoint per minute each slot is rewritten every 32 minutes,
+// so the EEPROM's 100,000 write cycles last about six years
+// #define CHECKPOINT
+const int CHECKPOINT_EEPROM_ADDR = 256;  // start of the checkpoint ring
+const uint8_t CHECKPOINT_SLOTS = 32;  // slots in the ring, 16 bytes each
+const unsigned long CHECKPOINT_INTERVAL_MS = 60000;  // min time between checkpoints
+
+// uncomment to make Gradient scroll up the installation and ColorExplosion
+// spread between physically adjacent LEDs, using the layout in
+// src/layout_table.h (generate it for your installation with tools/layout.py)
+// #define LAYOUT
+
+// uncomment to let a lighting controller drive the strip with DMX over UDP
+// (Art-Net or E1.31/sACN, see src/dmx.h); on AVR, build with
+// "pio run -e uno_dmx" instead, which defines it and adds the Ethernet
+// library the Ethernet shield needs
+// #define DMX_INGEST
+const unsigned int DMX_UDP_PORT = 6454;  // 6454 for Art-Net, 5568 for E1.31
+const uint8_t DMX_IP[4] = { 192, 168, 1, 177 };  // address of the strip on AVR
+const uint8_t DMX_MAC[6] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0x01 };
+const unsigned long DMX_TIMEOUT_MS = 2000;  // go back to the patterns after this long without data
+
+// uncomment to publish every frame shown into a shared memory ring for
+// live preview with tools/frameview.py (see src/frametap.h); native
+// (POSIX host) build only
+// #define FRAME_TAP
+const char FRAME_TAP_NAME[] = "/ledstrip-frames";  // appears as /dev/shm/ledstrip-frames
+const uint8_t FRAME_TAP_SLOTS = 8;  // frames the viewer may fall behind before dropping
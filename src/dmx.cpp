@@ -0,0 +1,231 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include "constants.h"
+#include "dmx.h"
+
+#ifdef DMX_INGEST
+
+#if defined(__AVR__)
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// universe to strip mapping; by default the first universe drives the
+// whole strip: Art-Net universe 0 or E1.31 universe 1 (a universe
+// carries at most 170 RGB LEDs)
+const DmxSegment dmxSegments[] = {
+  { 0, 1, 0, NUM_LEDS },
+};
+const unsigned char NUM_DMX_SEGMENTS = sizeof(dmxSegments) / sizeof(dmxSegments[0]);
+
+const int ARTNET_HEADER_SIZE = 18;
+const int E131_HEADER_SIZE = 126;
+
+// large enough for the larger header and the channels of every LED a
+// universe can drive on this strip; the rest of a longer packet is
+// never used, and is discarded
+const int DMX_MAX_PACKET = E131_HEADER_SIZE + 3 * (NUM_LEDS < 170 ? NUM_LEDS : 170);
+
+static uint8_t packet[DMX_MAX_PACKET];  // receive buffer, allocated once
+static uint8_t lastSequence[NUM_DMX_SEGMENTS];
+static uint8_t haveSequence[NUM_DMX_SEGMENTS];
+static unsigned long pendingSince = 0;  // receive time of the oldest unshown data
+static unsigned char pending = 0;
+static DmxStats stats;
+
+#if defined(__AVR__)
+static EthernetUDP udp;
+#else
+static int sock = -1;
+#endif
+
+
+void dmxBegin() {
+  #if defined(__AVR__)
+    Ethernet.begin((uint8_t *)DMX_MAC, IPAddress(DMX_IP[0], DMX_IP[1], DMX_IP[2], DMX_IP[3]));
+    udp.begin(DMX_UDP_PORT);
+  #else
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+      return;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(DMX_UDP_PORT);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      close(sock);
+      sock = -1;
+      return;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+  #endif
+}
+
+
+// Helper function that returns 1 if a packet with the given sequence
+// number should be applied to segment s, keeping track of lost packets.
+// As in E1.31, a packet up to 20 behind the last one is considered late
+// and dropped; one further behind means the sender restarted.  Art-Net
+// numbers packets 1 to 255 and uses 0 for senders that do not number
+// their packets; E1.31 uses all of 0 to 255.
+static unsigned char acceptSequence(unsigned char s, uint8_t sequence, unsigned char artnet) {
+  if (artnet && sequence == 0) {
+    return 1;
+  }
+  if (haveSequence[s]) {
+    signed char diff = sequence - lastSequence[s];
+    if (artnet && diff > 0 && sequence < lastSequence[s]) {
+      diff--;  // wrapped around from 255 to 1, skipping 0
+    }
+    if (diff <= 0 && diff > -20) {
+      return 0;
+    }
+    if (diff > 1) {
+      stats.lost += diff - 1;
+    }
+  }
+  haveSequence[s] = 1;
+  lastSequence[s] = sequence;
+  return 1;
+}
+
+
+// Helper function that returns the universe of segment in the
+// numbering of the protocol of the packet.
+static unsigned int segmentUniverse(const DmxSegment *segment, unsigned char artnet) {
+  return artnet ? segment->artnetUniverse : segment->e131Universe;
+}
+
+
+unsigned char dmxHandlePacket(const uint8_t *data, int length, CRGB colors[], int numLeds) {
+  unsigned int universe;
+  uint8_t sequence;
+  const uint8_t *channels;
+  int numChannels;
+  unsigned char artnet = 0;
+
+  if (length >= ARTNET_HEADER_SIZE && memcmp(data, "Art-Net", 8) == 0
+      && data[8] == 0x00 && data[9] == 0x50) {
+    // ArtDmx: little-endian opcode 0x5000, 15-bit universe
+    artnet = 1;
+    sequence = data[12];
+    universe = data[14] | ((data[15] & 0x7F) << 8);
+    numChannels = (data[16] << 8) | data[17];
+    channels = data + ARTNET_HEADER_SIZE;
+  }
+  else if (length >= E131_HEADER_SIZE && memcmp(data + 4, "ASC-E1.17\0\0\0", 12) == 0
+      && data[21] == 0x04 && data[43] == 0x02 && data[117] == 0x02 && data[125] == 0x00) {
+    // E1.31 data packet (root, framing and DMP vectors) with the
+    // null start code; skip preview data and stream terminations
+    if (data[112] & 0xC0) {
+      stats.ignored++;
+      return 0;
+    }
+    sequence = data[111];
+    universe = (data[113] << 8) | data[114];
+    numChannels = ((data[123] << 8) | data[124]) - 1;  // count includes the start code
+    channels = data + E131_HEADER_SIZE;
+  }
+  else {
+    stats.ignored++;
+    return 0;
+  }
+
+  int headerSize = channels - data;
+  if (numChannels > length - headerSize) {
+    numChannels = length - headerSize;  // never read past the packet
+  }
+
+  unsigned char applied = 0;
+  for (unsigned char s = 0; s < NUM_DMX_SEGMENTS; s++) {
+    const DmxSegment *segment = &dmxSegments[s];
+    if (segmentUniverse(segment, artnet) != universe || !acceptSequence(s, sequence, artnet)) {
+      continue;
+    }
+    int count = segment->numLeds;
+    if (count > numChannels / 3) {
+      count = numChannels / 3;
+    }
+    if (count > numLeds - segment->firstLed) {
+      count = numLeds - segment->firstLed;
+    }
+    for (int i = 0; i < count; i++) {
+      colors[segment->firstLed + i] = CRGB(channels[3*i], channels[3*i + 1], channels[3*i + 2]);
+    }
+    applied = 1;
+  }
+
+  if (!applied) {
+    // unmapped universe, or late for every segment it maps to
+    for (unsigned char s = 0; s < NUM_DMX_SEGMENTS; s++) {
+      if (segmentUniverse(&dmxSegments[s], artnet) == universe) {
+        stats.late++;
+        return 0;
+      }
+    }
+    stats.ignored++;
+    return 0;
+  }
+
+  stats.packets++;
+  if (!pending) {
+    pending = 1;
+    pendingSince = micros();
+  }
+  return 1;
+}
+
+
+unsigned char dmxPoll(CRGB colors[], int numLeds) {
+  unsigned char applied = 0;
+  #if defined(__AVR__)
+    while (udp.parsePacket() > 0) {
+      int length = udp.read(packet, DMX_MAX_PACKET);
+      udp.flush();  // discard anything that did not fit
+      applied += dmxHandlePacket(packet, length, colors, numLeds);
+    }
+  #else
+    if (sock < 0) {
+      return 0;
+    }
+    int length;
+    // recv() drops the part of a datagram that does not fit
+    while ((length = recv(sock, packet, DMX_MAX_PACKET, 0)) > 0) {
+      applied += dmxHandlePacket(packet, length, colors, numLeds);
+    }
+  #endif
+  return applied;
+}
+
+
+void dmxFrameShown() {
+  if (!pending) {
+    return;
+  }
+  unsigned long latency = micros() - pendingSince;
+  pending = 0;
+  stats.frames++;
+  stats.latencySumMicros += latency;
+  if (latency > stats.latencyMaxMicros) {
+    stats.latencyMaxMicros = latency;
+  }
+}
+
+
+const DmxStats *dmxGetStats() {
+  return &stats;
+}
+
+
+void dmxResetStats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include "FastLED.h"
+
+// part of the strip driven by one DMX universe: numLeds LEDs starting
+// at firstLed take their red, green and blue values from consecutive
+// channels starting at the first channel of the universe.  The two
+// protocols number universes differently (Art-Net from 0, E1.31 from 1,
+// 0 being reserved), so the universe is given for each.
+struct DmxSegment {
+  unsigned int artnetUniverse;
+  unsigned int e131Universe;
+  int firstLed;
+  int numLeds;
+};
+
+// receive statistics, since the last dmxResetStats()
+struct DmxStats {
+  unsigned long packets;  // packets applied to the colors array
+  unsigned long late;  // packets dropped for arriving out of sequence
+  unsigned long lost;  // packets never received (gaps in the sequence)
+  unsigned long ignored;  // not DMX data, or for an unmapped universe
+  unsigned long frames;  // frames shown with new data
+  unsigned long latencyMaxMicros;  // worst receive-to-show latency
+  unsigned long latencySumMicros;  // sum of the receive-to-show latencies
+};
+
+/*
+  This function opens the UDP port DMX_UDP_PORT: through an Ethernet
+  shield (W5100/W5500) at DMX_IP on AVR, or a non-blocking socket on
+  a POSIX host, so the receiver can be tested over loopback with
+  tools/dmx_send.py.
+*/
+void dmxBegin();
+
+/*
+  This function receives every packet waiting on the port and writes
+  its DMX data into the segments of the colors array mapped to its
+  universe (see dmxSegments in dmx.cpp).  It never waits for packets.
+  Packets are applied as they are read, so when several frames have
+  queued up the newest one wins and stale ones never hold up output.
+  Packets older than the last one applied for their universe (by
+  sequence number) are dropped.  Only the channels of the first
+  NUM_LEDS LEDs of a universe (170 at most) are read; the rest of a
+  longer packet is discarded.  It returns the number of packets
+  applied.
+*/
+unsigned char dmxPoll(CRGB colors[], int numLeds);
+
+/*
+  This function parses one Art-Net (ArtDmx) or E1.31 data packet held
+  in packet and applies it to the colors array as described for
+  dmxPoll(), returning 1 if it was applied and 0 otherwise.  It does
+  not depend on the network, so it can be fed packets from anywhere.
+*/
+unsigned char dmxHandlePacket(const uint8_t *packet, int length, CRGB colors[], int numLeds);
+
+/*
+  This function must be called right after a frame is shown; it
+  records the receive-to-show latency of the DMX data in that frame.
+*/
+void dmxFrameShown();
+
+/*
+  These functions return and clear the receive statistics.
+*/
+const DmxStats *dmxGetStats();
+void dmxResetStats();
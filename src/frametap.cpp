@@ -0,0 +1,113 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include "constants.h"
+#include "frametap.h"
+
+// the tap needs a POSIX host; main.cpp rejects FRAME_TAP on AVR
+#if !defined(__AVR__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static FrameTapHeader *header = NULL;  // start of the mapped ring
+static unsigned int slotSize = 0;  // bytes per slot, including the frame
+
+static unsigned long dropped = 0;
+static unsigned long long publishNanos = 0;
+static unsigned long published = 0;
+
+
+// Helper function that returns the time on the host's monotonic clock
+// in nanoseconds; a publish takes well under the microsecond micros()
+// counts in, so most would read as 0 with it.
+static unsigned long long clockNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+void frameTapBegin(int numLeds) {
+  slotSize = sizeof(FrameTapSlot) + ((numLeds * 3 + 3) & ~3);
+  size_t size = sizeof(FrameTapHeader) + FRAME_TAP_SLOTS * slotSize;
+
+  int fd = shm_open(FRAME_TAP_NAME, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    return;
+  }
+  if (ftruncate(fd, size) < 0) {
+    close(fd);
+    return;
+  }
+  void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping stays valid
+  if (memory == MAP_FAILED) {
+    return;
+  }
+
+  // a viewer may still be attached from an earlier run, so keep its
+  // flag, restart the frame count and publish the magic number last
+  header = (FrameTapHeader *)memory;
+  __atomic_store_n(&header->magic, 0, __ATOMIC_RELAXED);
+  memset((uint8_t *)memory + sizeof(FrameTapHeader), 0, FRAME_TAP_SLOTS * slotSize);
+  header->numLeds = numLeds;
+  header->slots = FRAME_TAP_SLOTS;
+  header->dropped = 0;
+  __atomic_store_n(&header->read, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&header->written, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&header->magic, FRAME_TAP_MAGIC, __ATOMIC_RELEASE);
+}
+
+
+void frameTapPublish(const CRGB leds[], int numLeds, uint8_t brightness) {
+  if (header == NULL) {
+    return;
+  }
+  unsigned long long start = clockNanos();
+
+  uint32_t frame = header->written;  // only this function writes it
+  FrameTapSlot *slot = (FrameTapSlot *)((uint8_t *)header + sizeof(FrameTapHeader)
+    + (frame % FRAME_TAP_SLOTS) * slotSize);
+
+  if (__atomic_load_n(&header->readerAttached, __ATOMIC_RELAXED)
+      && frame - __atomic_load_n(&header->read, __ATOMIC_ACQUIRE) >= FRAME_TAP_SLOTS) {
+    // the reader has fallen a whole ring behind; the frame in this
+    // slot is about to be lost
+    dropped++;
+    __atomic_store_n(&header->dropped, header->dropped + 1, __ATOMIC_RELAXED);
+  }
+
+  // sequence lock: odd while the slot is inconsistent
+  uint32_t sequence = slot->sequence;
+  __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->frame = frame;
+  slot->brightness = brightness;
+  memcpy((uint8_t *)slot + sizeof(FrameTapSlot), leds, numLeds * 3);
+  __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->written, frame + 1, __ATOMIC_RELEASE);
+
+  publishNanos += clockNanos() - start;
+  published++;
+}
+
+
+unsigned long frameTapDroppedFrames() {
+  return dropped;
+}
+
+
+unsigned long frameTapNanos() {
+  return published ? publishNanos / published : 0;
+}
+
+
+void frameTapResetStats() {
+  dropped = 0;
+  publishNanos = 0;
+  published = 0;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "FastLED.h"
+
+/*
+  Layout of the shared memory the frame tap publishes into: a header
+  followed by FRAME_TAP_SLOTS slots, each holding one frame.  Frame n
+  goes into slot n % FRAME_TAP_SLOTS.  Each slot is guarded by a
+  sequence lock: its sequence number is odd while the slot is being
+  written, so a reader copies the slot and keeps the copy only if the
+  sequence number was even and unchanged before and after.  The
+  producer never waits for the reader.  tools/frameview.py reads this
+  layout and must be kept in sync with it.
+*/
+struct FrameTapHeader {
+  uint32_t magic;  // FRAME_TAP_MAGIC once the header is initialized
+  uint16_t numLeds;
+  uint8_t slots;
+  uint8_t readerAttached;  // set by the reader while it is running
+  uint32_t written;  // frames published
+  uint32_t read;  // frames consumed, written by the reader
+  uint32_t dropped;  // frames overwritten before the reader consumed them
+};
+
+struct FrameTapSlot {
+  uint32_t sequence;  // odd while the slot is being written
+  uint32_t frame;  // number of the frame in the slot
+  uint8_t brightness;  // FastLED brightness the frame was shown with
+  uint8_t reserved[3];
+  // followed by numLeds * 3 bytes of red, green, blue, padded to 4 bytes
+};
+
+const uint32_t FRAME_TAP_MAGIC = 0x5041544C;  // "LTAP"
+
+/*
+  This function creates (or reuses) the shared memory object
+  FRAME_TAP_NAME, sized for numLeds LEDs, and maps it.  It needs a
+  POSIX host, so the tap is only available in the native build.  If
+  the object cannot be created the tap stays off and
+  frameTapPublish() does nothing.
+*/
+void frameTapBegin(int numLeds);
+
+/*
+  This function publishes the frame about to be shown into the next
+  slot of the ring.  It costs one copy of the frame and never blocks.
+  If a reader is attached and has not yet consumed the frame in that
+  slot, the dropped-frame counter is incremented.
+*/
+void frameTapPublish(const CRGB leds[], int numLeds, uint8_t brightness);
+
+/*
+  These functions return the number of frames dropped and the average
+  time taken by frameTapPublish(), in nanoseconds on the host's
+  monotonic clock, since the last call to frameTapResetStats(), which
+  clears them.
+*/
+unsigned long frameTapDroppedFrames();
+unsigned long frameTapNanos();
+void frameTapResetStats();
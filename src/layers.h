@@ -0,0 +1,233 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <Arduino.h>
+#include "FastLED.h"
+#include "patterns.h"
+
+/*
+  Layers that can be stacked into a single per-LED pass over the
+  colors array.  Every layer has an apply(i, color) method that gets
+  the color of LED i produced by the layers below it and returns the
+  new color: generators (GradientLayer, PaletteLayer, TwinkleLayer,
+  OverlayLayer) produce or add color, and modifiers (DimWaveLayer,
+  FadeLayer, MaskLayer) change the color they are given.  Layers are
+  combined with makeStack() and drawn with composite(), for example
+  twinkles over a gradient that is lit in bands:
+
+    composite(colors, numLeds, makeStack(
+      GradientLayer(numLeds, loopCount, NULL),
+      MaskLayer(8, 5, loopCount / 4),
+      TwinkleLayer(CRGB(255, 255, 255), loopCount, 64, seed)));
+
+  The stack is a template, so the whole chain is resolved and inlined
+  at compile time: however many layers there are, composite() reads
+  and writes each LED once, with no intermediate buffers and no
+  function pointers.
+*/
+
+
+// Helper function for the layers that scroll: the position of LED i
+// along the scroll direction, from 0 to numLeds-1.  That is its place
+// on the strip when positions is NULL, or else its entry in positions,
+// a position map in flash such as layoutScrollMap() (which scrolls the
+// layer up the installation).
+inline int layerPosition(int i, const uint8_t *positions) {
+  return positions ? pgm_read_byte(&positions[i]) : i;
+}
+
+
+// the 16 colors of one period of GradientLayer: red to green over 8
+// LEDs, then green to red over 8
+const uint8_t gradientLayerColors[16][3] PROGMEM = {
+  { 160, 0, 0 }, { 140, 20, 17 }, { 120, 40, 30 }, { 100, 60, 37 },
+  { 80, 80, 40 }, { 60, 100, 37 }, { 40, 120, 30 }, { 20, 140, 17 },
+  { 0, 160, 0 }, { 20, 140, 17 }, { 40, 120, 30 }, { 60, 100, 37 },
+  { 80, 80, 40 }, { 100, 60, 37 }, { 120, 40, 30 }, { 140, 20, 17 }
+};
+
+// red -> white -> green -> white -> red ... gradient that scrolls one
+// LED every two loopCounts (the colors of the Gradient pattern)
+struct GradientLayer {
+  int numLeds;
+  int offset;
+  const uint8_t *positions;
+
+  GradientLayer(int numLeds, int loopCount, const uint8_t *positions)
+    : numLeds(numLeds), offset(loopCount/2 % numLeds), positions(positions) {}
+
+  CRGB apply(int i, CRGB) const {
+    int j = layerPosition(i, positions) - offset;
+    if (j < 0) {
+      j += numLeds;
+    }
+    const uint8_t *color = gradientLayerColors[j & 15];
+    return CRGB(pgm_read_byte(&color[0]), pgm_read_byte(&color[1]), pgm_read_byte(&color[2]));
+  }
+};
+
+
+// how far DimWaveLayer shifts the channels right at each phase of its
+// period: dimmed over 7 LEDs, off (8) for 10, brought back over 7 and
+// left alone for 5
+const uint8_t dimWaveLayerShifts[29] PROGMEM = {
+  1, 2, 3, 4, 5, 6, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+  7, 6, 5, 4, 3, 2, 1, 0, 0, 0, 0, 0
+};
+
+// waves of dimness that scroll one LED every loopCount (the waves of
+// the Gradient pattern)
+struct DimWaveLayer {
+  static const unsigned char period = 29;
+  unsigned char start;  // phase of position 0
+  const uint8_t *positions;
+
+  // the waves wrap around numLeds rounded up to a whole period, so
+  // the phase of a position only depends on loopCount % period
+  DimWaveLayer(int, int loopCount, const uint8_t *positions)
+    : start((period - loopCount % period) % period), positions(positions) {}
+
+  // how far the channels of LED i are shifted right: 0 (fully bright)
+  // to 7, or 8 when the LED is off
+  unsigned char shift(int i) const {
+    return pgm_read_byte(&dimWaveLayerShifts[(unsigned int)(layerPosition(i, positions) + start) % period]);
+  }
+
+  CRGB apply(int i, CRGB c) const {
+    unsigned char s = shift(i);
+    if (s >= 8) {
+      return CRGB(0, 0, 0);
+    }
+    return CRGB(c.red >> s, c.green >> s, c.blue >> s);
+  }
+};
+
+
+// repeating bands of palette colors, width LEDs each
+struct PaletteLayer {
+  const CRGB *palette;
+  unsigned char size;
+  unsigned char width;
+  int offset;
+
+  PaletteLayer(const CRGB *palette, unsigned char size, unsigned char width, int offset)
+    : palette(palette), size(size), width(width), offset(offset) {}
+
+  CRGB apply(int i, CRGB) const {
+    return palette[((i + offset) / width) % size];
+  }
+};
+
+
+// twinkles added on top of the color below, saturating at 255: like
+// BrightTwinkle, but a function of loopCount alone, so there is no
+// state to keep between frames.  Every LED lights up to color once
+// every period loopCounts (a power of two), at a phase picked by a hash
+// of its index and seed, and its brightness halves every loopCount
+// after that until it is out.
+struct TwinkleLayer {
+  CRGB color;
+  unsigned int loopCount;
+  unsigned char period;
+  uint16_t seed;
+
+  TwinkleLayer(CRGB color, unsigned int loopCount, unsigned char period, uint16_t seed)
+    : color(color), loopCount(loopCount), period(period), seed(seed) {}
+
+  CRGB apply(int i, CRGB c) const {
+    uint16_t hash = (uint16_t)(i + seed) * 0x9E37;
+    hash ^= hash >> 7;
+    unsigned char age = (loopCount + hash) & (period - 1);
+    if (age >= 8) {
+      return c;
+    }
+    return CRGB(qadd8(c.red, color.red >> age), qadd8(c.green, color.green >> age),
+      qadd8(c.blue, color.blue >> age));
+  }
+};
+
+
+// adds the colors of a separate buffer on top, saturating at 255; for
+// example a stateful pattern such as brightTwinkle() drawn into its own
+// array
+struct OverlayLayer {
+  const CRGB *overlay;
+
+  OverlayLayer(const CRGB *overlay) : overlay(overlay) {}
+
+  CRGB apply(int i, CRGB c) const {
+    return CRGB(qadd8(c.red, overlay[i].red), qadd8(c.green, overlay[i].green),
+      qadd8(c.blue, overlay[i].blue));
+  }
+};
+
+
+// fades every channel with fade()
+struct FadeLayer {
+  unsigned char fadeTime;
+
+  FadeLayer(unsigned char fadeTime) : fadeTime(fadeTime) {}
+
+  CRGB apply(int, CRGB c) const {
+    fade(&c.red, fadeTime);
+    fade(&c.green, fadeTime);
+    fade(&c.blue, fadeTime);
+    return c;
+  }
+};
+
+
+// keeps the first lit LEDs of every period LEDs (a power of two) and
+// turns off the rest
+struct MaskLayer {
+  unsigned char period;
+  unsigned char lit;
+  int offset;
+
+  MaskLayer(unsigned char period, unsigned char lit, int offset)
+    : period(period), lit(lit), offset(offset) {}
+
+  CRGB apply(int i, CRGB c) const {
+    return ((i + offset) & (period - 1)) < lit ? c : CRGB(0, 0, 0);
+  }
+};
+
+
+// a stack of layers, applied bottom (first) to top (last)
+template <typename... Layers>
+struct LayerStack;
+
+template <>
+struct LayerStack<> {
+  CRGB apply(int, CRGB c) const {
+    return c;
+  }
+};
+
+template <typename First, typename... Rest>
+struct LayerStack<First, Rest...> {
+  First first;
+  LayerStack<Rest...> rest;
+
+  LayerStack(const First &first, const Rest&... rest) : first(first), rest(rest...) {}
+
+  CRGB apply(int i, CRGB c) const {
+    return rest.apply(i, first.apply(i, c));
+  }
+};
+
+template <typename... Layers>
+LayerStack<Layers...> makeStack(const Layers&... layers) {
+  return LayerStack<Layers...>(layers...);
+}
+
+
+// draws a layer stack into the colors array in a single pass
+template <typename Stack>
+void composite(CRGB colors[], int numLeds, const Stack &stack) {
+  for (int i = 0; i < numLeds; i++) {
+    colors[i] = stack.apply(i, colors[i]);
+  }
+}
+
+#endif
@@ -0,0 +1,37 @@
+#include <Arduino.h>
+#include "layout.h"
+#include "layout_table.h"
+
+
+unsigned char layoutMatches(int numLeds) {
+  return numLeds == LAYOUT_NUM_LEDS;
+}
+
+
+LedPosition layoutPosition(int i) {
+  LedPosition p;
+  p.x = pgm_read_byte(&layoutPositions[i].x);
+  p.y = pgm_read_byte(&layoutPositions[i].y);
+  p.z = pgm_read_byte(&layoutPositions[i].z);
+  return p;
+}
+
+
+const uint8_t *layoutScrollMap() {
+  return layoutScrollPositions;
+}
+
+
+uint8_t layoutRadialDistance(int i) {
+  return pgm_read_byte(&layoutRadial[i]);
+}
+
+
+uint8_t layoutLedAtHeight(int rank) {
+  return pgm_read_byte(&layoutByHeight[rank]);
+}
+
+
+uint8_t layoutNeighbour(int i, uint8_t n) {
+  return pgm_read_byte(&layoutNeighbours[i][n]);
+}
@@ -0,0 +1,69 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <Arduino.h>
+
+// physical position of an LED in compact fixed point
+struct LedPosition {
+  int8_t x;   // -127 to 127 across the installation
+  int8_t y;   // -127 to 127 across the installation
+  uint8_t z;  // height, 0 (bottom) to 255 (top)
+};
+
+const uint8_t LAYOUT_NUM_NEIGHBOURS = 2;  // neighbours stored per LED
+const uint8_t LAYOUT_NO_NEIGHBOUR = 255;
+
+/*
+  The layout describes where each LED physically is (for example wound
+  around a tree), so that patterns can follow the shape of the
+  installation instead of the order of the LEDs on the strip.  It is
+  stored in flash as tables generated by tools/layout.py
+  (src/layout_table.h): positions, heights scaled to the strip,
+  distances from the center axis, the LEDs sorted by height, and each
+  LED's physically closest LEDs.  Patterns only look values up in
+  these tables, so following the layout costs no trigonometry,
+  division or searching at runtime.
+*/
+
+/*
+  This function returns 1 if the layout table describes a strip of
+  numLeds LEDs, and 0 otherwise; patterns should fall back to strip
+  order when it does not.
+*/
+unsigned char layoutMatches(int numLeds);
+
+/*
+  This function returns the position of LED i.
+*/
+LedPosition layoutPosition(int i);
+
+/*
+  This function returns the table (in flash, read with pgm_read_byte())
+  of the height of each LED scaled to the strip: from 0 for the lowest
+  LED to numLeds-1 for the highest, with LEDs at the same height (such
+  as a row of a matrix) at the same position.  Layers that scroll take
+  it as their position map (see layers.h).
+*/
+const uint8_t *layoutScrollMap();
+
+/*
+  This function returns the distance of LED i from the center axis of
+  the installation, from 0 (on the axis) to 255 (furthest away).
+*/
+uint8_t layoutRadialDistance(int i);
+
+/*
+  This function returns the index of the LED at the given height rank:
+  0 is the lowest LED and numLeds-1 the highest.
+*/
+uint8_t layoutLedAtHeight(int rank);
+
+/*
+  This function returns neighbour n (0 to LAYOUT_NUM_NEIGHBOURS-1) of
+  LED i: one of the LEDs physically closest to it that are not next to
+  it on the strip (such as the LED on the turn above or below), or
+  LAYOUT_NO_NEIGHBOUR if it does not have that many.
+*/
+uint8_t layoutNeighbour(int i, uint8_t n);
+
+#endif
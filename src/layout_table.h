@@ -0,0 +1,63 @@
+// generated by tools/layout.py cone --leds 60 --turns 5 --width 10; do not edit
+
+const int LAYOUT_NUM_LEDS = 60;
+
+// x, y (-127 to 127) and height (0 to 255) of each LED
+const LedPosition layoutPositions[LAYOUT_NUM_LEDS] PROGMEM = {
+  { 127, 0, 0 }, { 108, 63, 4 }, { 60, 108, 9 }, { -3, 121, 13 },
+  { -63, 101, 17 }, { -104, 54, 22 }, { -115, -6, 26 }, { -95, -63, 30 },
+  { -49, -100, 35 }, { 9, -109, 39 }, { 62, -88, 43 }, { 96, -44, 48 },
+  { 103, 11, 52 }, { 82, 61, 56 }, { 39, 92, 61 }, { -13, 97, 65 },
+  { -59, 76, 69 }, { -88, 34, 73 }, { -91, -15, 78 }, { -69, -58, 82 },
+  { -30, -83, 86 }, { 16, -85, 91 }, { 56, -64, 95 }, { 78, -26, 99 },
+  { 79, 17, 104 }, { 58, 53, 108 }, { 22, 73, 112 }, { -18, 73, 117 },
+  { -51, 52, 121 }, { -68, 19, 125 }, { -66, -18, 130 }, { -47, -48, 134 },
+  { -15, -63, 138 }, { 18, -60, 143 }, { 45, -41, 147 }, { 58, -13, 151 },
+  { 54, 18, 156 }, { 36, 42, 160 }, { 10, 52, 164 }, { -17, 48, 169 },
+  { -38, 32, 173 }, { -47, 8, 177 }, { -43, -17, 182 }, { -27, -34, 186 },
+  { -6, -41, 190 }, { 15, -37, 194 }, { 30, -23, 199 }, { 36, -4, 203 },
+  { 31, 14, 207 }, { 18, 26, 212 }, { 2, 30, 216 }, { -12, 25, 220 },
+  { -22, 15, 225 }, { -24, 1, 229 }, { -20, -10, 233 }, { -11, -17, 238 },
+  { 0, -19, 242 }, { 8, -14, 246 }, { 13, -7, 251 }, { 13, 0, 255 }
+};
+
+// height of each LED scaled to the strip (0 to LAYOUT_NUM_LEDS-1)
+const uint8_t layoutScrollPositions[LAYOUT_NUM_LEDS] PROGMEM = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+  12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+  24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,
+  36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+  48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59
+};
+
+// distance of each LED from the center axis (0 to 255)
+const uint8_t layoutRadial[LAYOUT_NUM_LEDS] PROGMEM = {
+  255, 251, 247, 243, 239, 236, 232, 228, 224, 220, 216, 212,
+  208, 204, 201, 197, 193, 189, 185, 181, 177, 173, 169, 166,
+  162, 158, 154, 150, 146, 142, 138, 134, 131, 127, 123, 119,
+  115, 111, 107, 103, 99, 96, 92, 88, 84, 80, 76, 72,
+  68, 64, 61, 57, 53, 49, 45, 41, 37, 33, 29, 25
+};
+
+// LED indices sorted from lowest to highest
+const uint8_t layoutByHeight[LAYOUT_NUM_LEDS] PROGMEM = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+  12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+  24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,
+  36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+  48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59
+};
+
+// closest LEDs that are not next to each other on the strip (255: none)
+const uint8_t layoutNeighbours[LAYOUT_NUM_LEDS][LAYOUT_NUM_NEIGHBOURS] PROGMEM = {
+  { 12, 11 }, { 13, 12 }, { 14, 13 }, { 15, 14 }, { 16, 15 }, { 17, 16 },
+  { 18, 17 }, { 19, 18 }, { 20, 19 }, { 21, 20 }, { 22, 21 }, { 23, 22 },
+  { 24, 0 }, { 25, 1 }, { 26, 2 }, { 27, 3 }, { 28, 4 }, { 29, 5 },
+  { 30, 6 }, { 31, 7 }, { 32, 8 }, { 33, 9 }, { 34, 10 }, { 35, 11 },
+  { 36, 12 }, { 37, 13 }, { 38, 14 }, { 39, 15 }, { 40, 16 }, { 41, 17 },
+  { 42, 18 }, { 43, 19 }, { 44, 20 }, { 45, 21 }, { 46, 22 }, { 47, 23 },
+  { 48, 24 }, { 49, 25 }, { 50, 26 }, { 51, 27 }, { 52, 28 }, { 53, 52 },
+  { 53, 54 }, { 54, 55 }, { 55, 56 }, { 56, 57 }, { 57, 58 }, { 58, 59 },
+  { 50, 59 }, { 51, 59 }, { 52, 48 }, { 53, 49 }, { 54, 50 }, { 55, 51 },
+  { 56, 52 }, { 57, 53 }, { 58, 54 }, { 59, 55 }, { 56, 55 }, { 57, 56 }
+};
@@ -2,9 +2,44 @@
 #include "FastLED.h"
 #include "constants.h"
 #include "patterns.h"
+#include "prng.h"
 
+#ifdef AUDIO_REACTIVE
+#include "audio.h"
+#endif
+
+#ifdef BYTECODE_VM
+#include "vm.h"
+#endif
+
+#ifdef HIGH_PRECISION_OUTPUT
+#include "output.h"
+#endif
+
+#ifdef IDLE_SLEEP
+#include "sleep.h"
+#endif
+
+#ifdef CHECKPOINT
+#ifndef HAS_EEPROM
+#error "CHECKPOINT needs EEPROM"
+#endif
+#include "checkpoint.h"
+#endif
+
+#ifdef DMX_INGEST
+#include "dmx.h"
+#endif
+
+#ifdef FRAME_TAP
 #ifdef __AVR__
-#define HAS_EEPROM
+#error "FRAME_TAP needs a POSIX host"
+#endif
+#include "frametap.h"
+#endif
+
+#ifdef POWER_LIMIT
+#include "power.h"
 #endif
 
 #ifdef HAS_EEPROM
@@ -15,12 +50,30 @@ const uint8_t FRAME_PERIOD = 1000 / FRAMES_PER_SECOND;
 
 CRGB colors[NUM_LEDS];
 
+#ifdef HIGH_PRECISION_OUTPUT
+CRGB leds[NUM_LEDS];  // output of the fused output pass, sent to the strip
+OutputResidual ditherResidual[NUM_LEDS];  // carried by the output pass's dithering
+CRGB16 colors16[NUM_LEDS];  // frame of the patterns that render in 16 bits
+unsigned char showColors16 = 0;  // show colors16 instead of colors
+#endif
+
+#ifdef DMX_INGEST
+unsigned char dmxLive = 0;  // a lighting controller is driving the strip
+#endif
+
+#ifdef BYTECODE_VM
+const uint8_t NUM_STATES = 8;  // number of patterns to cycle through
+#else
 const uint8_t NUM_STATES = 7;  // number of patterns to cycle through
+#endif
 
 // system timer, incremented by one every time through the main loop
-unsigned int loopCount = 0;
+SHOW_STATE unsigned int loopCount = 0;
 
-unsigned int seed = 0;  // used to initialize random number generator
+SHOW_STATE unsigned int seed = 0;  // seed of the show; with patternRun, seeds the PRNG for each run
+SHOW_STATE unsigned int patternRun = 0;  // number of pattern runs since the show started
+SHOW_STATE unsigned int noiseSeed = 0;  // drawn at the start of each run
+SHOW_STATE unsigned char resumedFrame = 0;  // the next frame is the first after a resume
 
 // enumerate the possible patterns in the order they will cycle
 enum Pattern {
@@ -31,10 +84,11 @@ enum Pattern {
   Gradient = 4,
   BrightTwinkle = 5,
   Collision = 6,
+  Bytecode = 7,
   AllOff = 255
 };
-unsigned char pattern = TraditionalColors;
-unsigned int maxLoops;  // go to next state when loopCount >= maxLoops
+SHOW_STATE unsigned char pattern = TraditionalColors;
+SHOW_STATE unsigned int maxLoops;  // go to next state when loopCount >= maxLoops
 
 void initializeRandomSeed() {
   // initialize the random number generator with a seed obtained by
@@ -46,27 +100,192 @@ void initializeRandomSeed() {
   #ifdef HAS_EEPROM
     seed += EEPROM.read(0);  // get part of the seed from EEPROM
   #endif
-  randomSeed(seed);
+  prngSeed(seed);
 
   #ifdef HAS_EEPROM
     // save a random number in EEPROM to be used for random seed
     // generation the next time the program runs
-    EEPROM.write(0, random(256));
+    EEPROM.write(0, prngRandom(256));
+  #endif
+}
+
+// This function starts the current pattern from the beginning.  The
+// PRNG is reseeded from the show seed and the number of the run, so
+// each run can be reproduced on its own (see prng.h): the offline
+// renderer renders runs independently and in parallel this way.
+void startPattern() {
+  loopCount = 0;
+  prngSeed(((uint32_t)seed << 16) | patternRun);
+  // WarmWhiteShimmer and RandomColorWalk get their smooth random
+  // fluctuations in brightness/color from coherent noise; a new noise
+  // seed for every run keeps them from looking the same twice
+  noiseSeed = prngRandom(30000);
+  #ifdef BYTECODE_VM
+    vmReset();
+  #endif
+}
+
+// This function returns the pattern that follows p in the cycle.
+unsigned char patternAfter(unsigned char p) {
+  return ((unsigned char)(p+1))%NUM_STATES;
+}
+
+// This function restores the show from the newest checkpoint in
+// EEPROM and returns 1, or returns 0 if there is no usable checkpoint.
+// Since the checkpoint holds the show seed and the PRNG state, a
+// resumed show does not need initializeRandomSeed().
+unsigned char resumeFromCheckpoint() {
+  #ifdef CHECKPOINT
+    Checkpoint cp;
+    if (checkpointLoad(&cp) && cp.pattern < NUM_STATES) {
+      pattern = cp.pattern;
+      seed = cp.seed;
+      patternRun = cp.patternRun;
+      startPattern();  // draws the run's noise seed again
+      loopCount = cp.loopCount;
+      prngSetState(cp.prngState);
+      // the colors array was lost with the power, so restart the
+      // collision that was under way (its streams were drawn in it) and
+      // have showPattern() set up the other patterns again; the
+      // Bytecode pattern resumes with its VM cleared by startPattern()
+      // (see checkpoint.h)
+      collisionRestoreState(cp.collisionState - cp.collisionState % 3, cp.collisionCount);
+      resumedFrame = 1;
+      return 1;
+    }
+  #endif
+  return 0;
+}
+
+// This function queues a checkpoint of the current state of the show
+// to be written to EEPROM.
+void saveCheckpoint() {
+  #ifdef CHECKPOINT
+    Checkpoint cp;
+    cp.pattern = pattern;
+    cp.loopCount = loopCount;
+    cp.seed = seed;
+    cp.patternRun = patternRun;
+    cp.prngState = prngGetState();
+    collisionSaveState(&cp.collisionState, &cp.collisionCount);
+    checkpointSave(&cp);
   #endif
 }
 
 // initialization stuff
 void setup() {
-  FastLED.addLeds<LED_TYPE, DATA_PIN, CLOCK_PIN, COLOR_ORDER>(colors, NUM_LEDS);
-  FastLED.setCorrection(TypicalLEDStrip);
-  FastLED.setBrightness(BRIGHTNESS);
+  #ifdef HIGH_PRECISION_OUTPUT
+    // brightness and correction are applied by the output pass instead
+    FastLED.addLeds<LED_TYPE, DATA_PIN, CLOCK_PIN, COLOR_ORDER>(leds, NUM_LEDS);
+    FastLED.setCorrection(UncorrectedColor);
+    FastLED.setDither(DISABLE_DITHER);
+    outputBegin(BRIGHTNESS, TypicalLEDStrip);
+  #else
+    FastLED.addLeds<LED_TYPE, DATA_PIN, CLOCK_PIN, COLOR_ORDER>(colors, NUM_LEDS);
+    FastLED.setCorrection(TypicalLEDStrip);
+    FastLED.setBrightness(BRIGHTNESS);
+  #endif
+
+  unsigned char resumed = resumeFromCheckpoint();
+  if (!resumed) {
+    initializeRandomSeed();
+    startPattern();
+  }
+
+  #ifdef AUDIO_REACTIVE
+    audioBegin(AUDIO_PIN);  // must come after the analogRead calls above
+  #endif
+
+  #if defined(BYTECODE_VM) || defined(REPORT_STATS)
+    Serial.begin(SERIAL_BAUD);
+  #endif
 
-  initializeRandomSeed();
+  #ifdef BYTECODE_VM
+    vmBegin();
+  #endif
+
+  #ifdef DMX_INGEST
+    dmxBegin();
+  #endif
+
+  #ifdef FRAME_TAP
+    frameTapBegin(NUM_LEDS);
+  #endif
 
   pinMode(AUTOCYCLE_SWITCH_PIN, INPUT_PULLUP);
   pinMode(NEXT_PATTERN_BUTTON_PIN, INPUT_PULLUP);
 
-  delay(10);  // give pull-ups time raise the input voltage
+  // give pull-ups time raise the input voltage (well under a millisecond
+  // is enough, so keep it short when resuming to get a frame out quickly)
+  delay(resumed ? 1 : 10);
+
+  #ifdef IDLE_SLEEP
+    idleSleepBegin(NEXT_PATTERN_BUTTON_PIN, AUTOCYCLE_SWITCH_PIN);
+  #endif
+}
+
+// This function prints timing statistics for the pattern that is
+// ending on the serial port.
+void reportStats() {
+  #ifdef REPORT_STATS
+    Serial.print("pattern ");
+    Serial.println(pattern);
+    #ifdef HIGH_PRECISION_OUTPUT
+      Serial.print("  output pass: ");
+      Serial.print(outputMicros());
+      Serial.print(" us/frame, ");
+      Serial.print(outputMicros() * 1000 / NUM_LEDS);
+      Serial.println(" ns/LED");
+    #endif
+    #ifdef POWER_LIMIT
+      Serial.print("  peak draw: ");
+      Serial.print(powerPeakMilliamps());
+      Serial.print(" mA, frames limited: ");
+      Serial.println(powerLimitedFrames());
+      powerResetStats();
+    #endif
+    #ifdef IDLE_SLEEP
+      unsigned long active = idleSleepActiveMicros();
+      unsigned long total = active + idleSleepIdleMicros();
+      Serial.print("  duty cycle: ");
+      Serial.print(total ? active / (total / 1000 + 1) : 0);  // in tenths of a percent
+      Serial.println("/1000 active");
+      idleSleepResetStats();
+    #endif
+    #ifdef DMX_INGEST
+      const DmxStats *dmx = dmxGetStats();
+      Serial.print("  dmx packets: ");
+      Serial.print(dmx->packets);
+      Serial.print(", late: ");
+      Serial.print(dmx->late);
+      Serial.print(", lost: ");
+      Serial.print(dmx->lost);
+      Serial.print(", ignored: ");
+      Serial.println(dmx->ignored);
+      Serial.print("  receive to show: ");
+      Serial.print(dmx->frames ? dmx->latencySumMicros / dmx->frames : 0);
+      Serial.print(" us average, ");
+      Serial.print(dmx->latencyMaxMicros);
+      Serial.println(" us max");
+      dmxResetStats();
+    #endif
+    #ifdef FRAME_TAP
+      Serial.print("  frame tap: ");
+      Serial.print(frameTapNanos());
+      Serial.print(" ns/frame, dropped frames: ");
+      Serial.println(frameTapDroppedFrames());
+      frameTapResetStats();
+    #endif
+  #endif
+}
+
+// This function resets the timer and advances to the next pattern
+// in the cycle.
+void nextPattern() {
+  reportStats();
+  pattern = patternAfter(pattern);  // advance to next pattern
+  patternRun++;
+  startPattern();  // reset timer
 }
 
 // This function detects if the optional next pattern button is pressed
@@ -80,21 +299,50 @@ void handleNextPatternButton() {
       while (digitalRead(NEXT_PATTERN_BUTTON_PIN) == 0);
       delay(10);  // debounce the button
     }
-    loopCount = 0;  // reset timer
-    pattern = ((unsigned char)(pattern+1))%NUM_STATES;  // advance to next pattern
+    nextPattern();
   }
 }
 
-void showPattern() {
-  if (pattern == WarmWhiteShimmer || pattern == RandomColorWalk) {
-    // for these two patterns, we want to make sure we get the same
-    // random sequence six times in a row (this provides smoother
-    // random fluctuations in brightness/color)
-    if (loopCount % 6 == 0) {
-      seed = random(30000);
+// This function renders the current frame of the current pattern into
+// colors and returns how many milliseconds longer than FRAME_PERIOD
+// the frame should last (some patterns are meant to run slower).
+unsigned char showPattern(CRGB colors[], int numLeds) {
+  #ifdef AUDIO_REACTIVE
+    // in silence the patterns run as they do without audio; louder bass
+    // spawns more explosions, louder treble more twinkles, and a louder
+    // midrange lets the shimmer get brighter
+    audioUpdate();
+    unsigned char explosionBursts = 1 + (audioEnvelope(AudioBass) >> 6);
+    unsigned char twinkleBursts = 4 + (audioEnvelope(AudioTreble) >> 5);
+    unsigned char shimmerBrightness = 120 + (audioEnvelope(AudioMid) >> 1);
+  #else
+    const unsigned char explosionBursts = 1;
+    const unsigned char twinkleBursts = 4;
+    const unsigned char shimmerBrightness = 120;
+  #endif
+
+  #ifdef LAYOUT
+    const unsigned char useLayout = 1;
+  #else
+    const unsigned char useLayout = 0;
+  #endif
+
+  #ifdef HIGH_PRECISION_OUTPUT
+    showColors16 = 0;
+    if (loopCount == 0) {
+      // the 16-bit frame is cleared here, with the colors array cleared
+      // by whoever calls this, since only this function knows about it
+      for (int i = 0; i < numLeds; i++) {
+        colors16[i].red = colors16[i].green = colors16[i].blue = 0;
+      }
     }
-    randomSeed(seed);
-  }
+  #endif
+
+  // patterns that build each frame on the colors of the one before set
+  // them up at their first frame, and again at the first frame after
+  // resuming from a checkpoint, since the strip starts out dark then
+  unsigned char firstFrame = loopCount == 0 || resumedFrame;
+  resumedFrame = 0;
 
   // call the appropriate pattern routine based on state; these
   // routines just set the colors in the colors array
@@ -102,7 +350,7 @@ void showPattern() {
     case WarmWhiteShimmer:
       // warm white shimmer for 300 loopCounts, fading over last 70
       maxLoops = 300;
-      warmWhiteShimmer(loopCount > maxLoops - 70, colors, NUM_LEDS);
+      warmWhiteShimmer(loopCount > maxLoops - 70, colors, numLeds, loopCount, noiseSeed, shimmerBrightness);
       break;
 
     case RandomColorWalk:
@@ -110,10 +358,12 @@ void showPattern() {
       // to other colors for 400 loopCounts, fading over last 80
       maxLoops = 400;
       randomColorWalk(
-        loopCount == 0 ? 1 : 0,
+        firstFrame ? 1 : 0,
         loopCount > maxLoops - 80,
         colors,
-        NUM_LEDS
+        numLeds,
+        loopCount,
+        noiseSeed
       );
       break;
 
@@ -121,8 +371,15 @@ void showPattern() {
       // repeating pattern of red, green, orange, blue, magenta that
       // slowly moves for 400 loopCounts
       maxLoops = 400;
-      traditionalColors(colors, NUM_LEDS, loopCount, 2);
-      break;
+      #ifdef HIGH_PRECISION_OUTPUT
+        // in 16 bits, so the fades keep their dim ends (as do the
+        // other fading patterns below)
+        traditionalColors16(colors16, numLeds, loopCount);
+        showColors16 = 1;
+      #else
+        traditionalColors(colors, numLeds, loopCount);
+      #endif
+      return 2;  // add an extra 2ms delay to slow the movement down
 
     case ColorExplosion:
       // bursts of random color that radiate outwards from random points
@@ -130,11 +387,24 @@ void showPattern() {
       // of every 200 count cycle or over the over final 100 counts
       // (this creates a repeating bloom/decay effect)
       maxLoops = 630;
-      colorExplosion(
-        (loopCount % 200 > 130) || (loopCount > maxLoops - 100),
-        colors,
-        NUM_LEDS
-      );
+      #ifdef HIGH_PRECISION_OUTPUT
+        colorExplosion16(
+          (loopCount % 200 > 130) || (loopCount > maxLoops - 100),
+          colors16,
+          numLeds,
+          explosionBursts,
+          useLayout
+        );
+        showColors16 = 1;
+      #else
+        colorExplosion(
+          (loopCount % 200 > 130) || (loopCount > maxLoops - 100),
+          colors,
+          numLeds,
+          explosionBursts,
+          useLayout
+        );
+      #endif
       break;
 
     case Gradient:
@@ -142,9 +412,14 @@ void showPattern() {
       // across the strips for 250 counts; this pattern is overlaid with
       // waves of dimness that also scroll (at twice the speed)
       maxLoops = 250;
-      gradient(colors, NUM_LEDS, loopCount);
-      delay(6);  // add an extra 6ms delay to slow things down
-      break;
+      #ifdef HIGH_PRECISION_OUTPUT
+        // in 16 bits, so the dim ends of the waves are smooth ramps
+        gradient16(colors16, numLeds, loopCount, useLayout);
+        showColors16 = 1;
+      #else
+        gradient(colors, numLeds, loopCount, useLayout);
+      #endif
+      return 6;  // add an extra 6ms delay to slow things down
 
     case BrightTwinkle:
       // random LEDs light up brightly and fade away; it is a very similar
@@ -152,18 +427,27 @@ void showPattern() {
       // LEDs that light up); as time goes on, allow progressively more
       // colors, halting generation of new twinkles for last 100 counts.
       maxLoops = 1200;
-      if (loopCount < 400) {
-        brightTwinkle(0, 1, 0, colors, NUM_LEDS);  // only white for first 400 loopCounts
-      }
-      else if (loopCount < 650) {
-        brightTwinkle(0, 2, 0, colors, NUM_LEDS);  // white and red for next 250 counts
-      }
-      else if (loopCount < 900) {
-        brightTwinkle(1, 2, 0, colors, NUM_LEDS);  // red, and green for next 250 counts
-      }
-      else {
-        // red, green, blue, cyan, magenta, yellow for the rest of the time
-        brightTwinkle(1, 6, loopCount > maxLoops - 100, colors, NUM_LEDS);
+      {
+        unsigned char minColor = 0;
+        unsigned char numColors = 1;  // only white for first 400 loopCounts
+        if (loopCount >= 900) {
+          // red, green, blue, cyan, magenta, yellow for the rest of the time
+          minColor = 1;
+          numColors = 6;
+        }
+        else if (loopCount >= 650) {
+          minColor = 1;
+          numColors = 2;  // red, and green for next 250 counts
+        }
+        else if (loopCount >= 400) {
+          numColors = 2;  // white and red for next 250 counts
+        }
+        #ifdef HIGH_PRECISION_OUTPUT
+          brightTwinkle16(minColor, numColors, loopCount > maxLoops - 100, colors16, numLeds, twinkleBursts);
+          showColors16 = 1;
+        #else
+          brightTwinkle(minColor, numColors, loopCount > maxLoops - 100, colors, numLeds, twinkleBursts);
+        #endif
       }
       break;
 
@@ -173,17 +457,159 @@ void showPattern() {
       // white and fades; this repeats until the function indicates it
       // is done by returning 1, at which point we stop keeping maxLoops
       // just ahead of loopCount
-      if (!collision(colors, NUM_LEDS, loopCount)) {
-        maxLoops = loopCount + 2;
-      }
+      #ifdef HIGH_PRECISION_OUTPUT
+        if (!collision16(colors16, numLeds, loopCount)) {
+          maxLoops = loopCount + 2;
+        }
+        showColors16 = 1;
+      #else
+        if (!collision(colors, numLeds, loopCount)) {
+          maxLoops = loopCount + 2;
+        }
+      #endif
+      break;
+
+    #ifdef BYTECODE_VM
+    case Bytecode:
+      // run the program stored in EEPROM (or the built-in default)
+      // for 400 loopCounts
+      maxLoops = 400;
+      vmRun(colors, numLeds, loopCount);
       break;
+    #endif
   }
+  return 0;
+}
+
+#ifdef DMX_INGEST
+// This function switches between showing the patterns and showing the
+// frames of a lighting controller.  The controller has already set the
+// levels it wants, so its frames go to the strip as they are, limited
+// only by the power budget: without the gamma curve, brightness, color
+// correction and dithering the patterns are shown with.
+void setDmxLive(unsigned char live) {
+  dmxLive = live;
+  #ifndef HIGH_PRECISION_OUTPUT
+    // on the 8-bit path these are FastLED's; the output pass is simply
+    // skipped instead (see showFrame())
+    FastLED.setBrightness(live ? 255 : BRIGHTNESS);
+    FastLED.setCorrection(live ? CRGB(UncorrectedColor) : CRGB(TypicalLEDStrip));
+    FastLED.setDither(live ? DISABLE_DITHER : BINARY_DITHER);
+  #endif
+}
+#endif
+
+// update the LED strips with the colors in the colors array
+void showFrame() {
+  #ifdef DMX_INGEST
+    const unsigned char linear = dmxLive;
+  #else
+    const unsigned char linear = 0;
+  #endif
+
+  #ifdef HIGH_PRECISION_OUTPUT
+    if (linear) {
+      for (int i = 0; i < NUM_LEDS; i++) {
+        leds[i] = colors[i];
+      }
+    }
+    else if (showColors16) {
+      outputFrame16(colors16, leds, ditherResidual, NUM_LEDS);
+    }
+    else {
+      outputFrame(colors, leds, ditherResidual, NUM_LEDS);
+    }
+  #endif
+  #ifdef POWER_LIMIT
+    // FastLED applies the brightness while sending the frame, so
+    // limiting costs no extra pass over the LEDs
+    #ifdef HIGH_PRECISION_OUTPUT
+      unsigned long channelSum = linear ? powerChannelSum(leds, NUM_LEDS) : outputChannelSum();
+      FastLED.setBrightness(powerLimit(channelSum, NUM_LEDS, POWER_BUDGET_MA));
+    #else
+      FastLED.setBrightness(powerLimit(powerChannelSum(colors, NUM_LEDS), NUM_LEDS, POWER_BUDGET_MA,
+        linear ? 255 : BRIGHTNESS));
+    #endif
+  #endif
+  #ifdef FRAME_TAP
+    #ifdef HIGH_PRECISION_OUTPUT
+      frameTapPublish(leds, NUM_LEDS, FastLED.getBrightness());
+    #else
+      frameTapPublish(colors, NUM_LEDS, FastLED.getBrightness());
+    #endif
+  #endif
+  FastLED.show();
+
+  #ifdef DMX_INGEST
+    dmxFrameShown();
+  #endif
+
+  #ifdef REPORT_STATS
+    static unsigned char firstFrame = 1;
+    if (firstFrame) {
+      unsigned long bootMicros = micros();
+      firstFrame = 0;
+      Serial.print("first frame shown at ");
+      Serial.print(bootMicros);
+      Serial.println(" us");
+    }
+  #endif
 }
 
 // main loop
 void loop() {
   handleNextPatternButton();
 
+  #ifdef CHECKPOINT
+    // checkpoint at a bounded rate to spare the EEPROM; the write
+    // itself is spread over the following loops, one byte per loop
+    static unsigned long lastCheckpoint = 0;
+    checkpointPoll();
+    if (millis() - lastCheckpoint >= CHECKPOINT_INTERVAL_MS) {
+      lastCheckpoint = millis();
+      saveCheckpoint();
+    }
+  #endif
+
+  #ifdef BYTECODE_VM
+    if (vmPollSerial()) {
+      // a new program was received; show it right away
+      pattern = Bytecode;
+      patternRun++;
+      startPattern();
+    }
+  #endif
+
+  #ifdef DMX_INGEST
+    // while a lighting controller is sending data, show each update as
+    // soon as it arrives instead of running the patterns
+    static unsigned long lastDmxMillis = 0;
+    if (dmxPoll(colors, NUM_LEDS)) {
+      lastDmxMillis = millis();
+      if (!dmxLive) {
+        setDmxLive(1);
+      }
+      showFrame();
+    }
+    if (dmxLive) {
+      if (millis() - lastDmxMillis < DMX_TIMEOUT_MS) {
+        #ifdef REPORT_STATS
+          EVERY_N_MILLISECONDS(10000) {
+            reportStats();
+          }
+        #endif
+        #ifdef IDLE_SLEEP
+          // sleep between polls too; an update that arrives meanwhile
+          // waits in the Ethernet chip's buffer for at most a frame
+          idleSleepUntilNextFrame(FRAME_PERIOD * 1000UL);
+        #endif
+        return;
+      }
+      setDmxLive(0);  // the controller went quiet; resume the patterns
+      startPattern();
+    }
+  #endif
+
   if (loopCount == 0) {
     // whenever timer resets, clear the LED colors array (all off)
     for (int i = 0; i < NUM_LEDS; i++) {
@@ -191,19 +617,25 @@ void loop() {
     }
   }
 
-  showPattern();
+  unsigned char extraMillis = showPattern(colors, NUM_LEDS);
 
-  // update the LED strips with the colors in the colors array
-  EVERY_N_MILLISECONDS(FRAME_PERIOD) {
-    FastLED.show();
-  }
+  #ifdef IDLE_SLEEP
+    // every rendered frame is shown, and the rest of the frame period
+    // (lengthened for the patterns that run slower) is spent asleep
+    showFrame();
+    idleSleepUntilNextFrame((FRAME_PERIOD + extraMillis) * 1000UL);
+  #else
+    delay(extraMillis);
+    EVERY_N_MILLISECONDS(FRAME_PERIOD) {
+      showFrame();
+    }
+  #endif
   loopCount++;  // increment our loop counter/timer.
 
   if (loopCount >= maxLoops && !digitalRead(AUTOCYCLE_SWITCH_PIN)) {
     // if the time is up for the current pattern and the optional hold
     // switch is not grounding the AUTOCYCLE_SWITCH_PIN, clear the
     // loop counter and advance to the next pattern in the cycle
-    loopCount = 0;  // reset timer
-    pattern = ((unsigned char)(pattern+1))%NUM_STATES;  // advance to next pattern
+    nextPattern();
   }
 }
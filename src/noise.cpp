@@ -0,0 +1,129 @@
+#include <Arduino.h>
+#include "noise.h"
+
+// odd constants that spread neighbouring whole times and tracks over
+// the hash input space
+const uint16_t NOISE_TIME_STEP = 0x9E37;
+const uint16_t NOISE_TRACK_STEP = 0x3C6B;
+
+
+// Helper function that hashes a 16-bit input to a random-looking
+// 8-bit value with two rounds of xorshift-multiply.  On AVR a 16-bit
+// multiply is three hardware multiplies, so this is far cheaper than
+// drawing from the 32-bit generator.
+static uint8_t noiseHash(uint16_t x) {
+  x ^= x >> 8;
+  x *= 0x6D2B;
+  x ^= x >> 7;
+  x *= 0x2F75;
+  return x >> 8;
+}
+
+
+// Helper function that eases the fractional part of a time with
+// smoothstep, 3f^2 - 2f^3, so the noise has no visible kinks at whole
+// times.
+static uint8_t noiseEase(uint8_t f) {
+  uint16_t ff = (uint16_t)f * f;
+  uint16_t eased = ((uint32_t)ff * (768 - 2*f)) >> 16;
+  return eased > 255 ? 255 : eased;
+}
+
+
+// Helper function that interpolates between two hashed values (the
+// weight is halved so the product fits in a 16-bit int on AVR).
+static int noiseLerp(int v0, int v1, uint8_t weight) {
+  return v0 + (((v1 - v0) * (weight >> 1)) >> 7);
+}
+
+
+void noiseSeek(NoiseSampler *sampler, uint16_t seed, uint16_t time, uint8_t step) {
+  uint8_t whole = time >> 8;
+  uint16_t prevTime = time - step;
+  sampler->seed = seed;
+  sampler->time = time;
+  sampler->step = step;
+  // whole times wrap around with the time, so the noise has no seam
+  // when it does
+  sampler->base0 = seed + whole * NOISE_TIME_STEP;
+  sampler->base1 = seed + (uint8_t)(whole + 1) * NOISE_TIME_STEP;
+  sampler->basePrev = seed + (uint8_t)(whole - 1) * NOISE_TIME_STEP;
+  sampler->weight = noiseEase(time & 0xFF);
+  sampler->prevWeight = noiseEase(prevTime & 0xFF);
+  sampler->crossed = (prevTime >> 8) != whole;
+}
+
+
+uint8_t noiseSample(const NoiseSampler *sampler, uint16_t track) {
+  uint16_t x = track * NOISE_TRACK_STEP;
+  return noiseLerp(noiseHash(sampler->base0 + x), noiseHash(sampler->base1 + x), sampler->weight);
+}
+
+
+// Helper function that returns the change over the sampler's step
+// from the values at the whole times around it.  valuePrev is only
+// used if the step crossed a whole time.
+static int noiseStepChange(const NoiseSampler *sampler, int valuePrev, int value0, int value1) {
+  int now = noiseLerp(value0, value1, sampler->weight);
+  if (!sampler->crossed) {
+    // usual case: both times lie between the same two values
+    return now - noiseLerp(value0, value1, sampler->prevWeight);
+  }
+  return now - noiseLerp(valuePrev, value0, sampler->prevWeight);
+}
+
+
+int noiseChange(const NoiseSampler *sampler, uint16_t track) {
+  uint16_t x = track * NOISE_TRACK_STEP;
+  int valuePrev = sampler->crossed ? noiseHash(sampler->basePrev + x) : 0;
+  return noiseStepChange(sampler, valuePrev, noiseHash(sampler->base0 + x), noiseHash(sampler->base1 + x));
+}
+
+
+void noiseFollow(NoiseCache *cache, const NoiseSampler *sampler) {
+  if (cache->filled && cache->seed == sampler->seed && cache->time == (uint16_t)(sampler->time - sampler->step)) {
+    // carrying on from the previous frame: the values in last are the
+    // ones a step earlier, and only a step that crossed a whole time
+    // needs new values
+    if (sampler->crossed) {
+      for (uint8_t track = 0; track < NOISE_CACHE_TRACKS; track++) {
+        cache->value0[track] = cache->value1[track];
+        cache->value1[track] = noiseHash(sampler->base1 + track * NOISE_TRACK_STEP);
+      }
+    }
+  }
+  else {
+    // a different seed, or a jump in time: work out the values a step
+    // earlier too, so the next changes are the same as noiseChange()'s
+    for (uint8_t track = 0; track < NOISE_CACHE_TRACKS; track++) {
+      uint16_t x = track * NOISE_TRACK_STEP;
+      cache->value0[track] = noiseHash(sampler->base0 + x);
+      cache->value1[track] = noiseHash(sampler->base1 + x);
+      if (sampler->crossed) {
+        cache->last[track] = noiseLerp(noiseHash(sampler->basePrev + x), cache->value0[track], sampler->prevWeight);
+      }
+      else {
+        cache->last[track] = noiseLerp(cache->value0[track], cache->value1[track], sampler->prevWeight);
+      }
+    }
+    cache->filled = 1;
+    cache->seed = sampler->seed;
+  }
+  cache->time = sampler->time;
+
+  // the weight is read once so that the stores to the cache cannot
+  // change it, which lets this loop run on several tracks at a time
+  uint8_t weight = sampler->weight;
+  for (uint8_t track = 0; track < NOISE_CACHE_TRACKS; track++) {
+    uint8_t now = noiseLerp(cache->value0[track], cache->value1[track], weight);
+    cache->change[track] = now - cache->last[track];
+    cache->last[track] = now;
+  }
+}
+
+
+uint8_t noise8(uint16_t seed, uint16_t track, uint16_t time) {
+  NoiseSampler sampler;
+  noiseSeek(&sampler, seed, time, 0);
+  return noiseSample(&sampler, track);
+}
@@ -0,0 +1,103 @@
+#include <Arduino.h>
+
+/*
+  Coherent (value) noise for patterns that need smooth random
+  fluctuation.  A noise signal is a function of a seed, a track and a
+  time: each track (for example one color channel of one LED) is an
+  independent signal that moves smoothly through time.  Time is in 8.8
+  fixed point; at every whole number the signal takes a hashed random
+  value in [0, 255], and in between it eases from one value to the next.
+  Because it is a pure function of its inputs, any point can be
+  sampled directly (so a pattern can seek to any loopCount, for
+  example after resuming from a checkpoint) and no generator state is
+  consumed.  Everything is 8- and 16-bit integer arithmetic.
+
+  Patterns sample many tracks at the same time, so the work that only
+  depends on the time is done once per frame by noiseSeek(), leaving a
+  couple of hashes and one interpolation per sample.  Patterns that
+  follow their tracks from frame to frame keep them in a NoiseCache:
+  every track crosses a whole time on the same frame, so noiseFollow()
+  decides once per frame whether the cached values carry on, and each
+  track then costs a single interpolation, with its hashing done once
+  every 256 / step frames.  The evaluation is incremental through time
+  only: tracks are independent of each other, so neighbouring LEDs
+  flicker independently as they did with the random walks this
+  replaced, and there is nothing along the strip to carry from one LED
+  to the next.  (Noise that is coherent along the strip would make the
+  shimmer ripple instead of flicker.)
+*/
+struct NoiseSampler {
+  uint16_t seed;  // what the sampler was prepared with
+  uint16_t time;
+  uint8_t step;
+  uint16_t base0;  // hash inputs of the whole times either side of the time
+  uint16_t base1;
+  uint16_t basePrev;  // hash input of the whole time before base0
+  uint8_t weight;  // eased position between base0 and base1
+  uint8_t prevWeight;  // the same for the time one step earlier
+  uint8_t crossed;  // 1 if the step earlier was before base0
+};
+
+/*
+  Cached values of the first NOISE_CACHE_TRACKS tracks of one seed,
+  followed from frame to frame.  A cache filled with zeros is empty.
+*/
+const uint8_t NOISE_CACHE_TRACKS = 32;
+
+struct NoiseCache {
+  uint8_t filled;  // 1 once the values below have been worked out
+  uint16_t seed;  // seed and time the values were last brought up to
+  uint16_t time;
+  uint8_t value0[NOISE_CACHE_TRACKS];  // values at the whole times either side of the time
+  uint8_t value1[NOISE_CACHE_TRACKS];
+  uint8_t last[NOISE_CACHE_TRACKS];  // value of each track at the time
+  int8_t change[NOISE_CACHE_TRACKS];  // change of each track over the last step
+};
+
+/*
+  This function prepares sampler for sampling the noise with the
+  given seed at the given time, and for noiseChange() to return the
+  change since time - step.  step must be less than 256 (one whole
+  time unit).
+*/
+void noiseSeek(NoiseSampler *sampler, uint16_t seed, uint16_t time, uint8_t step);
+
+/*
+  This function returns the value of the given track at the time the
+  sampler was prepared for, in [0, 255].
+*/
+uint8_t noiseSample(const NoiseSampler *sampler, uint16_t track);
+
+/*
+  This function returns how much the given track changed over the
+  step the sampler was prepared with, between -255 and 255.  Adding up
+  the changes of successive steps gives back the sampled values, so a
+  pattern can use the noise to drive a bounded random walk.
+*/
+int noiseChange(const NoiseSampler *sampler, uint16_t track);
+
+/*
+  This function brings cache up to the time sampler was prepared for,
+  working out the changes of all its tracks over the sampler's step in
+  one pass, and is called once per frame before noiseChangeCached().
+  If the cache was last brought up to the time one step earlier with
+  the same seed, only the tracks' new values are hashed, and only on
+  the frames that cross a whole time; otherwise the cache is filled
+  afresh.
+*/
+void noiseFollow(NoiseCache *cache, const NoiseSampler *sampler);
+
+/*
+  This function returns the same as noiseChange(), from cache once
+  noiseFollow() has brought it up to the sampler's time.  Tracks past
+  the end of the cache are worked out with noiseChange().
+*/
+inline int noiseChangeCached(const NoiseSampler *sampler, uint16_t track, const NoiseCache *cache) {
+  return track < NOISE_CACHE_TRACKS ? cache->change[track] : noiseChange(sampler, track);
+}
+
+/*
+  This function returns the value of one track at one time, for
+  one-off samples.
+*/
+uint8_t noise8(uint16_t seed, uint16_t track, uint16_t time);
@@ -0,0 +1,78 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "FastLED.h"
+
+// color with 16 bits per channel, for patterns that render into a
+// high-precision buffer and hand it to outputFrame16(); the high byte
+// of each channel is the 8-bit level and the low byte a fraction of a
+// step above it
+struct CRGB16 {
+  uint16_t red;
+  uint16_t green;
+  uint16_t blue;
+  uint16_t &operator[](uint8_t x) { return (&red)[x]; }
+  const uint16_t &operator[](uint8_t x) const { return (&red)[x]; }
+};
+
+// fraction of an 8-bit step that the dithering of one LED carries over
+// to the next frame, per channel; the caller of outputFrame() keeps
+// one for every LED of the strip, zeroed at the start
+typedef uint8_t OutputResidual[3];
+
+/*
+  This function sets up the fused output pass.  brightness and
+  correction take the place of FastLED.setBrightness() and
+  FastLED.setCorrection(): when the output pass is used they are
+  applied here, so FastLED itself should be set to full brightness,
+  no correction and no dithering.
+*/
+void outputBegin(uint8_t brightness, const CRGB &correction);
+
+/*
+  This function converts the colors array into the 8-bit values that
+  are sent to the strip, in a single sweep over the LEDs.  Every
+  channel goes through a precomputed 16-bit gamma 2.2 table, is scaled by
+  the brightness and color correction in 16-bit precision, and is then
+  temporally dithered down to 8 bits: the part of the value below the
+  lowest 8-bit step is carried over to the next frame, so dim values
+  that fall between two 8-bit steps alternate between the two and
+  average out to the value instead of collapsing onto one of them.
+  At 120 frames per second the alternation is too fast to see at most
+  levels, but between the very lowest steps (where a step is a large
+  relative change) it can show as a faint shimmer.
+  The gamma curve changes the look of every pattern: the patterns
+  were tuned on the 8-bit path, which sends their levels to the strip
+  linearly, and through the curve the middle levels come out darker
+  (level 128 shows at about 22% instead of 50%) while full and off
+  stay the same.
+  out and residual must have room for numLeds LEDs.  The leftover
+  fractions are kept in residual rather than inside the pass, so
+  strips of any length, and any number of threads, can each have
+  their own.
+*/
+void outputFrame(const CRGB in[], CRGB out[], OutputResidual residual[], int numLeds);
+
+/*
+  This function works like outputFrame() but takes a high-precision
+  render buffer with 16 bits per channel.  The gamma table is linearly
+  interpolated between its 8-bit entries.
+*/
+void outputFrame16(const CRGB16 in[], CRGB out[], OutputResidual residual[], int numLeds);
+
+/*
+  This function returns the sum of all 8-bit channel values written to
+  the output buffer by the last output pass on this thread.  The pass adds up the
+  values as it writes them, so the power limiter gets the sum for one
+  addition per channel instead of a second sweep over the frame (the
+  8-bit path takes it with powerChannelSum(), see power.h).
+*/
+unsigned long outputChannelSum();
+
+/*
+  This function returns how long the last outputFrame() or
+  outputFrame16() call on this thread took, in microseconds.
+*/
+unsigned long outputMicros();
+
+#endif
@@ -1,12 +1,18 @@
 #include <Arduino.h>
 #include "FastLED.h"
+#include "constants.h"
+#include "patterns.h"
+#include "prng.h"
+#include "noise.h"
+#include "layout.h"
+#include "layers.h"
 
 
 void randomWalk(
   unsigned char *val, unsigned char maxVal, unsigned char changeAmount,
   unsigned char directions
 ) {
-  unsigned char walk = random(directions);  // direction of random walk
+  unsigned char walk = prngRandom(directions);  // direction of random walk
   if (walk == 0) {
     // decrease val by changeAmount down to a min of 0
     if (*val >= changeAmount) {
@@ -38,13 +44,84 @@ void fade(unsigned char *val, unsigned char fadeTime) {
 }
 
 
-void warmWhiteShimmer(unsigned char dimOnly, CRGB colors[], int numLeds) {
-  const unsigned char maxBrightness = 120;  // cap on LED brighness
-  const unsigned char changeAmount = 2;   // size of random walk step
+void fade16(uint16_t *val, unsigned char fadeTime) {
+  if (*val != 0) {
+    uint16_t subAmt = *val >> fadeTime;  // val * 2^-fadeTime
+    if (subAmt < 128)
+      subAmt = 128;  // at least half a level, so the fade ends about when fade()'s would
+    *val = *val > subAmt ? *val - subAmt : 0;
+  }
+}
+
+
+// Helper functions that let the fading patterns below be written once,
+// as templates, for 8-bit colors and for the 16-bit colors of
+// HIGH_PRECISION_OUTPUT (see output.h), whose channels hold the 8-bit
+// level in the high byte.
+static inline void setLevel(uint8_t *channel, uint8_t level) {
+  *channel = level;
+}
+
+static inline void setLevel(uint16_t *channel, uint8_t level) {
+  *channel = (uint16_t)level << 8;
+}
+
+static inline void fadeChannel(uint8_t *channel, unsigned char fadeTime) {
+  fade(channel, fadeTime);
+}
+
+static inline void fadeChannel(uint16_t *channel, unsigned char fadeTime) {
+  fade16(channel, fadeTime);
+}
+
+template <typename Color>
+static inline void setColor(Color *color, uint8_t red, uint8_t green, uint8_t blue) {
+  setLevel(&color->red, red);
+  setLevel(&color->green, green);
+  setLevel(&color->blue, blue);
+}
+
+
+// noise tracks followed from frame to frame by warmWhiteShimmer() and
+// randomColorWalk()
+static SHOW_STATE NoiseCache noiseCache;
+
+
+// Helper function that changes val by change, keeping it within
+// [0, maxVal]; with change taken from noiseChange() this is a smooth
+// bounded random walk.
+static void noiseWalk(unsigned char *val, unsigned char maxVal, int change) {
+  int newVal = *val + change;
+  if (newVal < 0) {
+    newVal = 0;
+  }
+  else if (newVal > maxVal) {
+    newVal = maxVal;
+  }
+  *val = newVal;
+}
+
+
+void warmWhiteShimmer(
+  unsigned char dimOnly,
+  CRGB colors[],
+  int numLeds,
+  unsigned int loopCount,
+  unsigned int noiseSeed,
+  unsigned char maxBrightness
+) {
+  const unsigned char changeAmount = 2;   // size of fade-out step
+  const unsigned char noiseStep = 8;  // noise time per frame; higher flickers faster
+
+  NoiseSampler noise;
+  noiseSeek(&noise, noiseSeed, loopCount * noiseStep, noiseStep);
+  if (!dimOnly) {
+    noiseFollow(&noiseCache, &noise);
+  }
 
   for (int i = 0; i < numLeds; i += 2) {
-    // randomly walk the brightness of every even LED
-    randomWalk(&colors[i].red, maxBrightness, changeAmount, dimOnly ? 1 : 2);
+    // smoothly walk the brightness of every even LED
+    noiseWalk(&colors[i].red, maxBrightness, dimOnly ? -changeAmount : noiseChangeCached(&noise, i >> 1, &noiseCache));
 
     // warm white: red = x, green = 0.8x, blue = 0.125x
     colors[i].green = colors[i].red*4/5;  // green = 80% of red
@@ -62,10 +139,19 @@ void randomColorWalk(
   unsigned char initializeColors,
   unsigned char dimOnly,
   CRGB colors[],
-  int numLeds
+  int numLeds,
+  unsigned int loopCount,
+  unsigned int noiseSeed
 ) {
   const unsigned char maxBrightness = 180;  // cap on LED brightness
-  const unsigned char changeAmount = 3;  // size of random walk step
+  const unsigned char changeAmount = 3;  // size of fade-out step
+  const unsigned char noiseStep = 8;  // noise time per frame; higher changes faster
+
+  NoiseSampler noise;
+  noiseSeek(&noise, noiseSeed, loopCount * noiseStep, noiseStep);
+  if (initializeColors == 0 && !dimOnly) {
+    noiseFollow(&noiseCache, &noise);
+  }
 
   // pick a good starting point for our pattern so the entire strip
   // is lit well (if we pick wrong, the last four LEDs could be off)
@@ -84,13 +170,16 @@ void randomColorWalk(
       start = 2;
   }
 
+  uint16_t track = 0;  // noise track of the red channel of LED i
   for (int i = start; i < numLeds; i+=7) {
     if (initializeColors == 0) {
-      // randomly walk existing colors of every seventh LED
+      // smoothly walk existing colors of every seventh LED, each
+      // channel following its own noise track
       // (neighboring LEDs to these will be dimmer versions of the same color)
-      randomWalk(&colors[i].red, maxBrightness, changeAmount, dimOnly ? 1 : 3);
-      randomWalk(&colors[i].green, maxBrightness, changeAmount, dimOnly ? 1 : 3);
-      randomWalk(&colors[i].blue, maxBrightness, changeAmount, dimOnly ? 1 : 3);
+      for (unsigned char ch = 0; ch < 3; ch++) {
+        noiseWalk(&colors[i][ch], maxBrightness, dimOnly ? -changeAmount : noiseChangeCached(&noise, track + ch, &noiseCache));
+      }
+      track += 3;
     }
     else if (initializeColors == 1) {
       // initialize LEDs to alternating red and green
@@ -103,7 +192,7 @@ void randomColorWalk(
     }
     else {
       // initialize LEDs to a string of random colors
-      colors[i] = CRGB(random(maxBrightness), random(maxBrightness), random(maxBrightness));
+      colors[i] = CRGB(prngRandom(maxBrightness), prngRandom(maxBrightness), prngRandom(maxBrightness));
     }
 
     // set neighboring LEDs to be progressively dimmer versions of the color we just set
@@ -123,12 +212,8 @@ void randomColorWalk(
 }
 
 
-void traditionalColors(
-  CRGB colors[],
-  int numLeds,
-  unsigned int loopCount,
-  unsigned int cycleDelay
-) {
+template <typename Color>
+static void drawTraditionalColors(Color colors[], int numLeds, unsigned int loopCount) {
   // loop counts to leave strip initially dark
   const unsigned char initialDarkCycles = 10;
   // loop counts it takes to go from full off to fully bright
@@ -161,42 +246,50 @@ void traditionalColors(
         // brightening cycle
         switch ((i/4)%5) {
            case 0:  // red
-             colors[idx].red = 200 * brightness/brighteningCycles;
-             colors[idx].green = 10 * brightness/brighteningCycles;
-             colors[idx].blue = 10 * brightness/brighteningCycles;
+             setLevel(&colors[idx].red, 200 * brightness/brighteningCycles);
+             setLevel(&colors[idx].green, 10 * brightness/brighteningCycles);
+             setLevel(&colors[idx].blue, 10 * brightness/brighteningCycles);
              break;
            case 1:  // green
-             colors[idx].red = 10 * brightness/brighteningCycles;
-             colors[idx].green = 200 * brightness/brighteningCycles;
-             colors[idx].blue = 10 * brightness/brighteningCycles;
+             setLevel(&colors[idx].red, 10 * brightness/brighteningCycles);
+             setLevel(&colors[idx].green, 200 * brightness/brighteningCycles);
+             setLevel(&colors[idx].blue, 10 * brightness/brighteningCycles);
              break;
            case 2:  // orange
-             colors[idx].red = 200 * brightness/brighteningCycles;
-             colors[idx].green = 120 * brightness/brighteningCycles;
-             colors[idx].blue = 0 * brightness/brighteningCycles;
+             setLevel(&colors[idx].red, 200 * brightness/brighteningCycles);
+             setLevel(&colors[idx].green, 120 * brightness/brighteningCycles);
+             setLevel(&colors[idx].blue, 0 * brightness/brighteningCycles);
              break;
            case 3:  // blue
-             colors[idx].red = 10 * brightness/brighteningCycles;
-             colors[idx].green = 10 * brightness/brighteningCycles;
-             colors[idx].blue = 200 * brightness/brighteningCycles;
+             setLevel(&colors[idx].red, 10 * brightness/brighteningCycles);
+             setLevel(&colors[idx].green, 10 * brightness/brighteningCycles);
+             setLevel(&colors[idx].blue, 200 * brightness/brighteningCycles);
              break;
            case 4:  // magenta
-             colors[idx].red = 200 * brightness/brighteningCycles;
-             colors[idx].green = 64 * brightness/brighteningCycles;
-             colors[idx].blue = 145 * brightness/brighteningCycles;
+             setLevel(&colors[idx].red, 200 * brightness/brighteningCycles);
+             setLevel(&colors[idx].green, 64 * brightness/brighteningCycles);
+             setLevel(&colors[idx].blue, 145 * brightness/brighteningCycles);
              break;
         }
       }
       else {
         // fade the 3/4 of LEDs that we are not currently brightening
-        fade(&colors[idx].red, 3);
-        fade(&colors[idx].green, 3);
-        fade(&colors[idx].blue, 3);
+        fadeChannel(&colors[idx].red, 3);
+        fadeChannel(&colors[idx].green, 3);
+        fadeChannel(&colors[idx].blue, 3);
       }
     }
   }
+}
+
+
+void traditionalColors(CRGB colors[], int numLeds, unsigned int loopCount) {
+  drawTraditionalColors(colors, numLeds, loopCount);
+}
+
 
-  delay(cycleDelay);
+void traditionalColors16(CRGB16 colors[], int numLeds, unsigned int loopCount) {
+  drawTraditionalColors(colors, numLeds, loopCount);
 }
 
 
@@ -224,6 +317,62 @@ void brightTwinkleColorAdjust(unsigned char *color) {
 }
 
 
+// Helper functions that do the same for the 16-bit colors: the
+// brightening values 2^n-1 are kept as 2^(n+8)-1, all ones in the low
+// byte too, so a channel is still brightening when it is odd and fading
+// when it is even, and a fading channel keeps all but the lowest bit of
+// the fraction of its level.  The fade takes off at least two levels a
+// frame, as the 8-bit one does once keeping the color even costs it an
+// extra level, so twinkles last as long (49 frames) in both.
+// spark() starts a channel brightening and isSpreading() tells whether
+// it is at 31, where ColorExplosion spreads to the neighbours.
+void brightTwinkleColorAdjust(uint16_t *color) {
+  if (*color == 0xFFFF) {
+    *color = 0xFFFE;
+  }
+  else if (*color % 2) {
+    *color = *color * 2 + 1;
+  }
+  else if (*color > 0) {
+    uint16_t subAmt = *color >> 4;
+    if (subAmt < 512) {
+      subAmt = 512;
+    }
+    *color = *color > subAmt ? (*color - subAmt) & ~1 : 0;
+  }
+}
+
+static inline void spark(uint8_t *channel) {
+  *channel = 1;
+}
+
+static inline void spark(uint16_t *channel) {
+  *channel = 0x01FF;
+}
+
+static inline unsigned char isSpreading(uint8_t channel) {
+  return channel == 31;
+}
+
+static inline unsigned char isSpreading(uint16_t channel) {
+  return channel == 0x1FFF;
+}
+
+template <typename Color>
+static inline void sparkColor(Color *color, unsigned char red, unsigned char green, unsigned char blue) {
+  setColor(color, 0, 0, 0);
+  if (red) {
+    spark(&color->red);
+  }
+  if (green) {
+    spark(&color->green);
+  }
+  if (blue) {
+    spark(&color->blue);
+  }
+}
+
+
 // Helper function for adjusting the colors for the ColorExplosion
 // pattern.  Odd colors get brighter and even colors get dimmer.
 // The propChance argument determines the likelihood that neighboring
@@ -231,25 +380,63 @@ void brightTwinkleColorAdjust(unsigned char *color) {
 // is 31 (chance is: 1 - 1/(propChance+1)).  The neighboring LED colors
 // are pointed to by leftColor and rightColor (it is not important that
 // the leftColor LED actually be on the "left" in your setup).
-void colorExplosionColorAdjust(unsigned char *color, unsigned char propChance,
- unsigned char *leftColor, unsigned char *rightColor) {
-  if (*color == 31 && random(propChance+1) != 0) {
+template <typename Channel>
+void colorExplosionColorAdjust(Channel *color, unsigned char propChance,
+ Channel *leftColor, Channel *rightColor) {
+  if (isSpreading(*color) && prngRandom(propChance+1) != 0) {
     if (leftColor != 0 && *leftColor == 0) {
-      *leftColor = 1;  // if left LED exists and color is zero, propagate
+      spark(leftColor);  // if left LED exists and color is zero, propagate
     }
     if (rightColor != 0 && *rightColor == 0) {
-      *rightColor = 1;  // if right LED exists and color is zero, propagate
+      spark(rightColor);  // if right LED exists and color is zero, propagate
     }
   }
   brightTwinkleColorAdjust(color);
 }
 
 
-void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds) {
+// Helper function for the ColorExplosion pattern when it follows the
+// physical layout.  It gives the channels of LED i that are about to
+// spread to their strip neighbours (color 31, see
+// colorExplosionColorAdjust()) the same chance to spread to the LEDs
+// physically next to LED i, such as the ones on the turns above and
+// below it on a tree.
+template <typename Color>
+void colorExplosionLayoutPropagate(Color colors[], int i, unsigned char propChance) {
+  for (unsigned char c = 0; c < 3; c++) {
+    if (!isSpreading(colors[i][c])) {
+      continue;
+    }
+    for (unsigned char n = 0; n < LAYOUT_NUM_NEIGHBOURS; n++) {
+      unsigned char j = layoutNeighbour(i, n);
+      if (j != LAYOUT_NO_NEIGHBOUR && colors[j][c] == 0 && prngRandom(propChance+1) != 0) {
+        spark(&colors[j][c]);
+      }
+    }
+  }
+}
+
+
+template <typename Color>
+static void drawColorExplosion(
+  unsigned char noNewBursts,
+  Color colors[],
+  int numLeds,
+  unsigned char numBursts,
+  unsigned char useLayout
+) {
+  decltype(&colors[0].red) none = 0;  // no neighbour past the ends of the strip
+
+  if (useLayout && layoutMatches(numLeds)) {
+    for (int i = 0; i < numLeds; i++) {
+      colorExplosionLayoutPropagate(colors, i, 9);
+    }
+  }
+
   // adjust the colors of the first LED
-  colorExplosionColorAdjust(&colors[0].red, 9, (unsigned char*)0, &colors[1].red);
-  colorExplosionColorAdjust(&colors[0].green, 9, (unsigned char*)0, &colors[1].green);
-  colorExplosionColorAdjust(&colors[0].blue, 9, (unsigned char*)0, &colors[1].blue);
+  colorExplosionColorAdjust(&colors[0].red, 9, none, &colors[1].red);
+  colorExplosionColorAdjust(&colors[0].green, 9, none, &colors[1].green);
+  colorExplosionColorAdjust(&colors[0].blue, 9, none, &colors[1].blue);
 
   for (int i = 1; i < numLeds - 1; i++) {
     // adjust the colors of second through second-to-last LEDs
@@ -259,23 +446,23 @@ void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds) {
   }
 
   // adjust the colors of the last LED
-  colorExplosionColorAdjust(&colors[numLeds-1].red, 9, &colors[numLeds-2].red, (unsigned char*)0);
-  colorExplosionColorAdjust(&colors[numLeds-1].green, 9, &colors[numLeds-2].green, (unsigned char*)0);
-  colorExplosionColorAdjust(&colors[numLeds-1].blue, 9, &colors[numLeds-2].blue, (unsigned char*)0);
+  colorExplosionColorAdjust(&colors[numLeds-1].red, 9, &colors[numLeds-2].red, none);
+  colorExplosionColorAdjust(&colors[numLeds-1].green, 9, &colors[numLeds-2].green, none);
+  colorExplosionColorAdjust(&colors[numLeds-1].blue, 9, &colors[numLeds-2].blue, none);
 
   if (!noNewBursts) {
-    // if we are generating new bursts, randomly pick one new LED
+    // if we are generating new bursts, randomly pick numBursts new LEDs
     // to light up
-    for (int i = 0; i < 1; i++) {
-      int j = random(numLeds);  // randomly pick an LED
+    for (int i = 0; i < numBursts; i++) {
+      int j = prngRandom(numLeds);  // randomly pick an LED
 
       // randomly pick a color
-      switch(random(7)) {
+      switch(prngRandom(7)) {
         // 2/7 chance we will spawn a red burst here (if LED has no red component)
         case 0:
         case 1:
           if (colors[j].red == 0) {
-            colors[j].red = 1;
+            spark(&colors[j].red);
           }
           break;
 
@@ -283,7 +470,7 @@ void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds) {
         case 2:
         case 3:
           if (colors[j].green == 0) {
-            colors[j].green = 1;
+            spark(&colors[j].green);
           }
           break;
 
@@ -291,14 +478,14 @@ void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds) {
         case 4:
         case 5:
           if ((colors[j].red == 0) && (colors[j].green == 0) && (colors[j].blue == 0)) {
-            colors[j] = CRGB(1, 1, 1);
+            sparkColor(&colors[j], 1, 1, 1);
           }
           break;
 
         // 1/7 chance we will spawn a blue burst here (if LED has no blue component)
         case 6:
           if (colors[j].blue == 0) {
-            colors[j].blue = 1;
+            spark(&colors[j].blue);
           }
           break;
 
@@ -310,12 +497,36 @@ void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds) {
 }
 
 
-void brightTwinkle(
+void colorExplosion(
+  unsigned char noNewBursts,
+  CRGB colors[],
+  int numLeds,
+  unsigned char numBursts,
+  unsigned char useLayout
+) {
+  drawColorExplosion(noNewBursts, colors, numLeds, numBursts, useLayout);
+}
+
+
+void colorExplosion16(
+  unsigned char noNewBursts,
+  CRGB16 colors[],
+  int numLeds,
+  unsigned char numBursts,
+  unsigned char useLayout
+) {
+  drawColorExplosion(noNewBursts, colors, numLeds, numBursts, useLayout);
+}
+
+
+template <typename Color>
+static void drawBrightTwinkle(
   unsigned char minColor,
   unsigned char numColors,
   unsigned char noNewBursts,
-  CRGB colors[],
-  int numLeds
+  Color colors[],
+  int numLeds,
+  unsigned char numBursts
 ) {
   // Note: the colors themselves are used to encode additional state
   // information.  If the color is one less than a power of two
@@ -333,38 +544,38 @@ void brightTwinkle(
   }
 
   if (!noNewBursts) {
-    // if we are generating new twinkles, randomly pick four new LEDs
+    // if we are generating new twinkles, randomly pick numBursts new LEDs
     // to light up
-    for (int i = 0; i < 4; i++) {
-      int j = random(numLeds);
+    for (int i = 0; i < numBursts; i++) {
+      int j = prngRandom(numLeds);
       if (colors[j].red == 0 && colors[j].green == 0 && colors[j].blue == 0) {
         // if the LED we picked is not already lit, pick a random
         // color for it and seed it so that it will start getting
         // brighter in that color
-        switch (random(numColors) + minColor) {
+        switch (prngRandom(numColors) + minColor) {
           case 0:
-            colors[j] = CRGB(1, 1, 1);  // white
+            sparkColor(&colors[j], 1, 1, 1);  // white
             break;
           case 1:
-            colors[j] = CRGB(1, 0, 0);  // red
+            sparkColor(&colors[j], 1, 0, 0);  // red
             break;
           case 2:
-            colors[j] = CRGB(0, 1, 0);  // green
+            sparkColor(&colors[j], 0, 1, 0);  // green
             break;
           case 3:
-            colors[j] = CRGB(0, 0, 1);  // blue
+            sparkColor(&colors[j], 0, 0, 1);  // blue
             break;
           case 4:
-            colors[j] = CRGB(1, 1, 0);  // yellow
+            sparkColor(&colors[j], 1, 1, 0);  // yellow
             break;
           case 5:
-            colors[j] = CRGB(0, 1, 1);  // cyan
+            sparkColor(&colors[j], 0, 1, 1);  // cyan
             break;
           case 6:
-            colors[j] = CRGB(1, 0, 1);  // magenta
+            sparkColor(&colors[j], 1, 0, 1);  // magenta
             break;
           default:
-            colors[j] = CRGB(1, 1, 1);  // white
+            sparkColor(&colors[j], 1, 1, 1);  // white
         }
       }
     }
@@ -372,88 +583,84 @@ void brightTwinkle(
 }
 
 
-void gradient(CRGB colors[], int numLeds, int loopCount) {
-  unsigned int j = 0;
+void brightTwinkle(
+  unsigned char minColor,
+  unsigned char numColors,
+  unsigned char noNewBursts,
+  CRGB colors[],
+  int numLeds,
+  unsigned char numBursts
+) {
+  drawBrightTwinkle(minColor, numColors, noNewBursts, colors, numLeds, numBursts);
+}
 
-  // populate colors array with full-brightness gradient colors
-  // (since the array indices are a function of loopCount, the gradient
-  // colors scroll over time)
-  while (j < numLeds) {
-    // transition from red to green over 8 LEDs
-    for (int i = 0; i < 8; i++) {
-      if (j >= numLeds){ break; }
-      colors[(loopCount/2 + j + numLeds)%numLeds] = CRGB(160 - 20*i, 20*i, (160 - 20*i)*20*i/160);
-      j++;
-    }
-    // transition from green to red over 8 LEDs
-    for (int i = 0; i < 8; i++) {
-      if (j >= numLeds){ break; }
-      colors[(loopCount/2 + j + numLeds)%numLeds] = CRGB(20*i, 160 - 20*i, (160 - 20*i)*20*i/160);
-      j++;
-    }
-  }
 
-  // modify the colors array to overlay the waves of dimness
-  // (since the array indices are a function of loopCount, the waves
-  // of dimness scroll over time)
-  const unsigned char fullDarkLEDs = 10;  // number of LEDs to leave fully off
-  const unsigned char fullBrightLEDs = 5;  // number of LEDs to leave fully bright
-  const unsigned char cyclePeriod = 14 + fullDarkLEDs + fullBrightLEDs;
+void brightTwinkle16(
+  unsigned char minColor,
+  unsigned char numColors,
+  unsigned char noNewBursts,
+  CRGB16 colors[],
+  int numLeds,
+  unsigned char numBursts
+) {
+  drawBrightTwinkle(minColor, numColors, noNewBursts, colors, numLeds, numBursts);
+}
 
-  // if numLeds is not an exact multiple of our repeating pattern size,
-  // it will not wrap around properly, so we pick the closest LED count
-  // that is an exact multiple of the pattern period (cyclePeriod) and is not
-  // smaller than the actual LED count.
-  unsigned int extendedLEDCount = (((numLeds-1)/cyclePeriod)+1)*cyclePeriod;
-
-  j = 0;
-  while (j < extendedLEDCount) {
-    unsigned int idx;
-
-    // progressively dim the LEDs
-    for (int i = 1; i < 8; i++) {
-      idx = (j + loopCount) % extendedLEDCount;
-      if (j++ >= extendedLEDCount){ return; }
-      if (idx >= numLeds){ continue; }
-
-      colors[idx].red >>= i;
-      colors[idx].green >>= i;
-      colors[idx].blue >>= i;
-    }
 
-    // turn off these LEDs
-    for (int i = 0; i < fullDarkLEDs; i++) {
-      idx = (j + loopCount) % extendedLEDCount;
-      if (j++ >= extendedLEDCount){ return; }
-      if (idx >= numLeds){ continue; }
+void gradient(CRGB colors[], int numLeds, int loopCount, unsigned char useLayout) {
+  const uint8_t *positions = useLayout && layoutMatches(numLeds) ? layoutScrollMap() : NULL;
 
-      colors[idx].red = 0;
-      colors[idx].green = 0;
-      colors[idx].blue = 0;
-    }
+  // draw the full-brightness gradient colors and overlay the waves of
+  // dimness in a single pass over the LEDs (both are a function of
+  // loopCount, so they scroll over time; the waves at twice the speed)
+  composite(colors, numLeds, makeStack(
+    GradientLayer(numLeds, loopCount, positions),
+    DimWaveLayer(numLeds, loopCount, positions)
+  ));
+}
 
-    // progressively bring these LEDs back
-    for (int i = 0; i < 7; i++) {
-      idx = (j + loopCount) % extendedLEDCount;
-      if (j++ >= extendedLEDCount){ return; }
-      if (idx >= numLeds){ continue; }
 
-      colors[idx].red >>= (7 - i);
-      colors[idx].green >>= (7 - i);
-      colors[idx].blue >>= (7 - i);
-    }
+void gradient16(CRGB16 colors[], int numLeds, int loopCount, unsigned char useLayout) {
+  const uint8_t *positions = useLayout && layoutMatches(numLeds) ? layoutScrollMap() : NULL;
+  GradientLayer colorLayer(numLeds, loopCount, positions);
+  DimWaveLayer waveLayer(numLeds, loopCount, positions);
 
-    // skip over these LEDs to leave them at full brightness
-    j += fullBrightLEDs;
+  for (int i = 0; i < numLeds; i++) {
+    CRGB c = colorLayer.apply(i, CRGB(0, 0, 0));
+    unsigned char shift = waveLayer.shift(i);
+    if (shift >= 8) {
+      c = CRGB(0, 0, 0);  // the LED is off
+      shift = 0;
+    }
+    colors[i].red = ((uint16_t)c.red << 8) >> shift;
+    colors[i].green = ((uint16_t)c.green << 8) >> shift;
+    colors[i].blue = ((uint16_t)c.blue << 8) >> shift;
   }
 }
 
 
-unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
+// state of the Collision pattern, kept outside collision() so that it
+// can be checkpointed with collisionSaveState()/collisionRestoreState()
+static SHOW_STATE unsigned char state = 0;  // pattern state
+static SHOW_STATE unsigned int count = 0;  // counter used by pattern
+
+
+void collisionSaveState(unsigned char *savedState, unsigned int *savedCount) {
+  *savedState = state;
+  *savedCount = count;
+}
+
+
+void collisionRestoreState(unsigned char savedState, unsigned int savedCount) {
+  state = savedState;
+  count = savedCount;
+}
+
+
+template <typename Color>
+static unsigned char drawCollision(Color colors[], int numLeds, int loopCount) {
   const unsigned char maxBrightness = 180;  // max brightness for the colors
   const unsigned char numCollisions = 5;  // # of collisions before pattern ends
-  static unsigned char state = 0;  // pattern state
-  static unsigned int count = 0;  // counter used by pattern
 
   if (loopCount == 0) {
     state = 0;
@@ -463,23 +670,24 @@ unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
     // initialization state
     switch (state/3) {
       case 0:  // first collision: red streams
-        colors[0] = CRGB(maxBrightness, 0, 0);
+        setColor(&colors[0], maxBrightness, 0, 0);
         break;
       case 1:  // second collision: green streams
-        colors[0] = CRGB(0, maxBrightness, 0);
+        setColor(&colors[0], 0, maxBrightness, 0);
         break;
       case 2:  // third collision: blue streams
-        colors[0] = CRGB(0, 0, maxBrightness);
+        setColor(&colors[0], 0, 0, maxBrightness);
         break;
       case 3:  // fourth collision: warm white streams
-        colors[0] = CRGB(maxBrightness, maxBrightness*4/5, maxBrightness>>3);
+        setColor(&colors[0], maxBrightness, maxBrightness*4/5, maxBrightness>>3);
         break;
       default:  // fifth collision and beyond: random-color streams
-        colors[0] = CRGB(random(maxBrightness), random(maxBrightness), random(maxBrightness));
+        setColor(&colors[0], prngRandom(maxBrightness), prngRandom(maxBrightness), prngRandom(maxBrightness));
     }
 
     // stream is led by two full-white LEDs
-    colors[1] = colors[2] = CRGB(255, 255, 255);
+    setColor(&colors[1], 255, 255, 255);
+    colors[2] = colors[1];
     // make other side of the strip a mirror image of this side
     colors[numLeds - 1] = colors[0];
     colors[numLeds - 2] = colors[1];
@@ -499,18 +707,18 @@ unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
       // if streams have not crossed the half-way point, keep them growing
       for (int i = 0; i < startIdx-1; i++) {
         // start fading previously generated parts of the stream
-        fade(&colors[i].red, 5);
-        fade(&colors[i].green, 5);
-        fade(&colors[i].blue, 5);
-        fade(&colors[numLeds - i - 1].red, 5);
-        fade(&colors[numLeds - i - 1].green, 5);
-        fade(&colors[numLeds - i - 1].blue, 5);
+        fadeChannel(&colors[i].red, 5);
+        fadeChannel(&colors[i].green, 5);
+        fadeChannel(&colors[i].blue, 5);
+        fadeChannel(&colors[numLeds - i - 1].red, 5);
+        fadeChannel(&colors[numLeds - i - 1].green, 5);
+        fadeChannel(&colors[numLeds - i - 1].blue, 5);
       }
       for (int i = startIdx; i <= stopIdx; i++) {
         // generate new parts of the stream
         if (i >= (numLeds + 1) / 2) {
           // anything past the halfway point is white
-          colors[i] = CRGB(255, 255, 255);
+          setColor(&colors[i], 255, 255, 255);
         }
         else {
           colors[i] = colors[i-1];
@@ -519,7 +727,8 @@ unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
         colors[numLeds - i - 1] = colors[i];
       }
       // stream is led by two full-white LEDs
-      colors[stopIdx + 1] = colors[stopIdx + 2] = CRGB(255, 255, 255);
+      setColor(&colors[stopIdx + 1], 255, 255, 255);
+      colors[stopIdx + 2] = colors[stopIdx + 1];
       // make other side of the strip a mirror image of this side
       colors[numLeds - stopIdx - 2] = colors[stopIdx + 1];
       colors[numLeds - stopIdx - 3] = colors[stopIdx + 2];
@@ -528,7 +737,7 @@ unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
       // streams have crossed the half-way point of the strip;
       // flash the entire strip full-brightness white (ignores maxBrightness limits)
       for (int i = 0; i < numLeds; i++) {
-        colors[i] = CRGB(255, 255, 255);
+        setColor(&colors[i], 255, 255, 255);
       }
       state++;  // advance to next state
     }
@@ -549,32 +758,42 @@ unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
     for (int i = 0; i < numLeds; i++) {
       switch (state/3) {
         case 0:  // fade through green
-          fade(&colors[i].red, 3);
-          fade(&colors[i].green, 4);
-          fade(&colors[i].blue, 2);
+          fadeChannel(&colors[i].red, 3);
+          fadeChannel(&colors[i].green, 4);
+          fadeChannel(&colors[i].blue, 2);
           break;
         case 1:  // fade through red
-          fade(&colors[i].red, 4);
-          fade(&colors[i].green, 3);
-          fade(&colors[i].blue, 2);
+          fadeChannel(&colors[i].red, 4);
+          fadeChannel(&colors[i].green, 3);
+          fadeChannel(&colors[i].blue, 2);
           break;
         case 2:  // fade through yellow
-          fade(&colors[i].red, 4);
-          fade(&colors[i].green, 4);
-          fade(&colors[i].blue, 3);
+          fadeChannel(&colors[i].red, 4);
+          fadeChannel(&colors[i].green, 4);
+          fadeChannel(&colors[i].blue, 3);
           break;
         case 3:  // fade through blue
-          fade(&colors[i].red, 3);
-          fade(&colors[i].green, 2);
-          fade(&colors[i].blue, 4);
+          fadeChannel(&colors[i].red, 3);
+          fadeChannel(&colors[i].green, 2);
+          fadeChannel(&colors[i].blue, 4);
           break;
         default:  // stay white through entire fade
-          fade(&colors[i].red, 4);
-          fade(&colors[i].green, 4);
-          fade(&colors[i].blue, 4);
+          fadeChannel(&colors[i].red, 4);
+          fadeChannel(&colors[i].green, 4);
+          fadeChannel(&colors[i].blue, 4);
       }
     }
   }
 
   return 0;
 }
+
+
+unsigned char collision(CRGB colors[], int numLeds, int loopCount) {
+  return drawCollision(colors, numLeds, loopCount);
+}
+
+
+unsigned char collision16(CRGB16 colors[], int numLeds, int loopCount) {
+  return drawCollision(colors, numLeds, loopCount);
+}
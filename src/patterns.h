@@ -1,4 +1,8 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
 #include "FastLED.h"
+#include "output.h"
 
 /*
   This function applies a random walk to val by increasing or
@@ -31,39 +35,62 @@ void randomWalk(
 */
 void fade(unsigned char *val, unsigned char fadeTime);
 
+/*
+  This function fades a channel of a 16-bit color (see output.h) the
+  way fade() fades an 8-bit one, keeping the fraction of a level that
+  fade() rounds away.  It decreases val by at least half a level
+  (fade() takes off at least a whole one), so a fade takes about as
+  many frames as it does with fade() but follows its curve further
+  down.
+*/
+void fade16(uint16_t *val, unsigned char fadeTime);
+
 /*
   ***** PATTERN WarmWhiteShimmer *****
-  This function randomly increases or decreases the brightness of the
-  even red LEDs by changeAmount, capped at maxBrightness.  The green
-  and blue LED values are set proportional to the red value so that
-  the LED color is warm white.  Each odd LED is set to a quarter the
-  brightness of the preceding even LEDs.  The dimOnly argument
-  disables the random increase option when it is true, causing
-  all the LEDs to get dimmer by changeAmount; this can be used for a
-  fade-out effect.
+  This function smoothly and randomly increases or decreases the
+  brightness of the even red LEDs, capped at maxBrightness, by
+  following each LED's track of the coherent noise (see noise.h)
+  seeded with noiseSeed at time loopCount.  The green and blue LED
+  values are set proportional to the red value so that the LED color
+  is warm white.  Each odd LED is set to a quarter the brightness of
+  the preceding even LEDs.  The dimOnly argument disables the random
+  walk when it is true, causing all the LEDs to get dimmer by
+  changeAmount; this can be used for a fade-out effect.
+  maxBrightness defaults to 120; raising it (for example from an
+  audio envelope) lets the shimmer get brighter.
 */
-void warmWhiteShimmer(unsigned char dimOnly, CRGB colors[], int numLeds);
+void warmWhiteShimmer(
+  unsigned char dimOnly,
+  CRGB colors[],
+  int numLeds,
+  unsigned int loopCount,
+  unsigned int noiseSeed,
+  unsigned char maxBrightness = 120
+);
 
 /*
   ***** PATTERN RandomColorWalk *****
   This function randomly changes the color of every seventh LED by
-  randomly increasing or decreasing the red, green, and blue components
-  by changeAmount (capped at maxBrightness) or leaving them unchanged.
+  smoothly increasing or decreasing the red, green, and blue components
+  (capped at maxBrightness), each following its own track of the
+  coherent noise (see noise.h) seeded with noiseSeed at time loopCount.
   The two preceding and following LEDs are set to progressively dimmer
   versions of the central color.  The initializeColors argument
   determines how the colors are initialized:
     0: randomly walk the existing colors
     1: set the LEDs to alternating red and green segments
     2: set the LEDs to random colors
-  When true, the dimOnly argument changes the random walk into a 100%
-  chance of LEDs getting dimmer by changeAmount; this can be used for
-  a fade-out effect.
+  When true, the dimOnly argument replaces the random walk with the
+  LEDs getting dimmer by changeAmount; this can be used for a fade-out
+  effect.
 */
 void randomColorWalk(
   unsigned char initializeColors,
   unsigned char dimOnly,
   CRGB colors[],
-  int numLeds
+  int numLeds,
+  unsigned int loopCount,
+  unsigned int noiseSeed
 );
 
 /*
@@ -77,8 +104,7 @@ void randomColorWalk(
 void traditionalColors(
   CRGB colors[],
   int numLeds,
-  unsigned int loopCount,
-  unsigned int cycleDelay
+  unsigned int loopCount
 );
 
 /*
@@ -92,11 +118,21 @@ void traditionalColors(
   or orange.
   When true, the noNewBursts argument changes prevents the generation
   of new bursts; this can be used for a fade-out effect.
+  numBursts is the number of LEDs picked each call to start a new
+  burst (1 by default).  When useLayout is true, bursts also spread to
+  the LEDs physically next to each LED according to the layout (see
+  layout.h), not only to its neighbours on the strip.
   This function uses a very similar algorithm to the BrightTwinkle
   pattern.  The main difference is that the random twinkling LEDs of
   the BrightTwinkle pattern do not propagate to neighboring LEDs.
 */
-void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds);
+void colorExplosion(
+  unsigned char noNewBursts,
+  CRGB colors[],
+  int numLeds,
+  unsigned char numBursts = 1,
+  unsigned char useLayout = 0
+);
 
 /*
   ***** PATTERN BrightTwinkle *****
@@ -110,6 +146,8 @@ void colorExplosion(unsigned char noNewBursts, CRGB colors[], int numLeds);
   will produce green and blue twinkles only.
   When true, the noNewBursts argument changes prevents the generation
   of new twinkles; this can be used for a fade-out effect.
+  numBursts is the number of LEDs picked each call to start a new
+  twinkle (4 by default).
   This function uses a very similar algorithm to the ColorExplosion
   pattern.  The main difference is that the random twinkling LEDs of
   this BrightTwinkle pattern do not propagate to neighboring LEDs.
@@ -119,7 +157,8 @@ void brightTwinkle(
   unsigned char numColors,
   unsigned char noNewBursts,
   CRGB colors[],
-  int numLeds
+  int numLeds,
+  unsigned char numBursts = 4
 );
 
 /*
@@ -127,9 +166,23 @@ void brightTwinkle(
   This function creates a scrolling color gradient that smoothly
   transforms from red to white to green back to white back to red.
   This pattern is overlaid with waves of brightness and dimness that
-  scroll at twice the speed of the color gradient.
+  scroll at twice the speed of the color gradient.  When useLayout is
+  true, the color and brightness of each LED are taken from its height
+  in the layout (see layout.h) instead of its place on the strip, so
+  they scroll up the installation in horizontal bands.
 */
-void gradient(CRGB colors[], int numLeds, int loopCount);
+void gradient(CRGB colors[], int numLeds, int loopCount, unsigned char useLayout = 0);
+
+/*
+  This function draws the same frame as gradient() into a buffer with
+  16 bits per channel (see output.h), for HIGH_PRECISION_OUTPUT.  The
+  waves of dimness shift the colors right by up to 7 bits, which in 8
+  bits leaves only a few levels at the dim end of each wave; here the
+  bits shifted out are kept, so the output pass can show the dim end
+  as a smooth ramp.  Rounded down to 8 bits, the frame is exactly the
+  one gradient() draws.
+*/
+void gradient16(CRGB16 colors[], int numLeds, int loopCount, unsigned char useLayout = 0);
 
 /*
   ***** PATTERN Collision *****
@@ -141,3 +194,40 @@ void gradient(CRGB colors[], int numLeds, int loopCount);
   still in progress).
 */
 unsigned char collision(CRGB colors[], int numLeds, int loopCount);
+
+/*
+  These functions draw the same patterns as traditionalColors(),
+  colorExplosion(), brightTwinkle() and collision() into a buffer with
+  16 bits per channel (see output.h), for HIGH_PRECISION_OUTPUT.  They
+  fade with fade16(), so the dim ends of their fades are not cut to a
+  few 8-bit steps before the output pass dithers them.  Like the 8-bit
+  versions they build each frame on the one before, so the buffer must
+  be kept between calls and cleared at the start of each run.
+*/
+void traditionalColors16(CRGB16 colors[], int numLeds, unsigned int loopCount);
+void colorExplosion16(
+  unsigned char noNewBursts,
+  CRGB16 colors[],
+  int numLeds,
+  unsigned char numBursts = 1,
+  unsigned char useLayout = 0
+);
+void brightTwinkle16(
+  unsigned char minColor,
+  unsigned char numColors,
+  unsigned char noNewBursts,
+  CRGB16 colors[],
+  int numLeds,
+  unsigned char numBursts = 4
+);
+unsigned char collision16(CRGB16 colors[], int numLeds, int loopCount);
+
+/*
+  These functions save and restore the internal state of the Collision
+  pattern (the only pattern that keeps state outside the colors array),
+  so that a point in the show can be checkpointed and resumed.
+*/
+void collisionSaveState(unsigned char *savedState, unsigned int *savedCount);
+void collisionRestoreState(unsigned char savedState, unsigned int savedCount);
+
+#endif
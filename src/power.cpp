@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include "constants.h"
+#include "power.h"
+
+static unsigned long peakMilliamps = 0;
+static unsigned int limitedFrames = 0;
+
+
+unsigned long powerChannelSum(const CRGB colors[], int numLeds) {
+  unsigned long sum = 0;
+  for (int i = 0; i < numLeds; i++) {
+    sum += colors[i].red + colors[i].green + colors[i].blue;
+  }
+  return sum;
+}
+
+
+uint8_t powerLimit(unsigned long channelSum, int numLeds, unsigned int budgetMilliamps, uint8_t brightness) {
+  unsigned long idle = (unsigned long)numLeds * MA_IDLE_PER_LED;
+  // draw above idle at full brightness and at the given brightness,
+  // rounded up so the limit errs on the safe side; FastLED's scale8()
+  // scales each channel by (brightness + 1)/256 (rounded down)
+  unsigned long full = (channelSum * MA_PER_CHANNEL + 254) / 255;
+  unsigned long lit = (full * (brightness + 1) + 255) >> 8;
+
+  if (idle + lit > peakMilliamps) {
+    peakMilliamps = idle + lit;
+  }
+  if (idle + lit <= budgetMilliamps) {
+    return brightness;
+  }
+
+  limitedFrames++;
+  if (idle >= budgetMilliamps) {
+    return 0;  // the budget does not even cover the idle draw
+  }
+  // the largest brightness whose (brightness + 1)/256 share of the full
+  // draw is at or under the budget
+  unsigned long scale = (budgetMilliamps - idle) * 256 / full;
+  if (scale == 0) {
+    return 0;
+  }
+  return scale - 1 > brightness ? brightness : scale - 1;
+}
+
+
+unsigned long powerPeakMilliamps() {
+  return peakMilliamps;
+}
+
+
+unsigned int powerLimitedFrames() {
+  return limitedFrames;
+}
+
+
+void powerResetStats() {
+  peakMilliamps = 0;
+  limitedFrames = 0;
+}
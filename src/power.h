@@ -0,0 +1,36 @@
+#include <Arduino.h>
+#include "FastLED.h"
+
+/*
+  This function returns the sum of all the 8-bit channel values of a
+  rendered frame, for powerLimit().  It is one sweep over the frame:
+  the patterns write the colors array directly, so there is no point
+  at which a single pixel change could be added to a running total.
+  With HIGH_PRECISION_OUTPUT the output pass adds up the values it
+  sends as it writes them (see outputChannelSum()), so no sweep is
+  needed there.
+*/
+unsigned long powerChannelSum(const CRGB colors[], int numLeds);
+
+/*
+  This function returns the brightness to show the frame at so that
+  its estimated draw stays within budgetMilliamps: brightness itself
+  (the brightness FastLED is set to) if the frame is already within
+  budget, and less if it is not.  channelSum is the sum of all the
+  8-bit channel values of the frame, and the draw is estimated as
+  MA_IDLE_PER_LED for every LED plus MA_PER_CHANNEL for each channel
+  at full brightness, proportionally less for dimmer channels and a
+  lower brightness.  Color correction is left out of the estimate, so
+  it errs on the safe side.  It also records the statistics returned
+  by powerPeakMilliamps() and powerLimitedFrames().
+*/
+uint8_t powerLimit(unsigned long channelSum, int numLeds, unsigned int budgetMilliamps, uint8_t brightness = 255);
+
+/*
+  These functions return the highest estimated draw (before limiting)
+  and the number of frames that had to be scaled down since the last
+  call to powerResetStats().
+*/
+unsigned long powerPeakMilliamps();
+unsigned int powerLimitedFrames();
+void powerResetStats();
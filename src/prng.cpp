@@ -0,0 +1,36 @@
+#include <Arduino.h>
+#include "constants.h"
+#include "prng.h"
+
+static SHOW_STATE uint32_t prngState = 1;  // never 0
+
+
+void prngSeed(uint32_t seed) {
+  // scramble the seed so that small or similar seeds do not give
+  // similar sequences, then make sure the state is not zero (the one
+  // state xorshift cannot leave)
+  seed = (seed ^ (seed >> 16)) * (uint32_t)0x45D9F3B;
+  seed ^= seed >> 16;
+  prngState = seed ? seed : 1;
+}
+
+
+long prngRandom(long howBig) {
+  uint32_t x = prngState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  prngState = x;
+  // scale the top 16 bits into [0, howBig) without a division
+  return ((x >> 16) * (uint32_t)howBig) >> 16;
+}
+
+
+uint32_t prngGetState() {
+  return prngState;
+}
+
+
+void prngSetState(uint32_t state) {
+  prngState = state ? state : 1;
+}
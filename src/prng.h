@@ -0,0 +1,41 @@
+#include <Arduino.h>
+
+/*
+  Pseudo-random number generator used by all the patterns in place of
+  Arduino's random()/randomSeed().  It is a 32-bit xorshift generator,
+  which is much cheaper on AVR than avr-libc's random() (no 32-bit
+  division), and unlike random() its whole state can be read back and
+  restored.
+
+  The show reseeds the generator at the start of every pattern run
+  from the show seed and the number of the run (see startPattern() in
+  main.cpp).  Nothing else carries over from one run to the next: the
+  colors are cleared, Collision resets its state and the bytecode VM
+  clears its registers and palette (vmReset()); the noise cache in
+  patterns.cpp only saves recomputing values that depend on the noise
+  seed alone.  So the frames of a run are fully described by the
+  pattern, the show seed, the run number and the strip length, which
+  is what lets the offline renderer (src/render.cpp) render runs
+  independently.  Two things outside the patterns are not covered: the
+  audio envelopes (AUDIO_REACTIVE) follow the music, and the dithering
+  residuals of the output pass (HIGH_PRECISION_OUTPUT) depend on every
+  frame shown before.
+*/
+
+/*
+  This function seeds the generator.  Every seed, including 0, gives a
+  valid state, and nearby seeds give unrelated sequences.
+*/
+void prngSeed(uint32_t seed);
+
+/*
+  This function returns a pseudo-random number in [0, howBig), like
+  random(howBig).  howBig must be at most 65535.
+*/
+long prngRandom(long howBig);
+
+/*
+  These functions read and restore the complete generator state.
+*/
+uint32_t prngGetState();
+void prngSetState(uint32_t state);
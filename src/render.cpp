@@ -0,0 +1,336 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include "constants.h"
+
+// offline renderer, built by [env:render] in platformio.ini instead of
+// running the show in real time
+#ifdef RENDER_CLI
+
+#ifdef AUDIO_REACTIVE
+#error "the renderer has no audio input; build it without AUDIO_REACTIVE"
+#endif
+
+#ifdef HIGH_PRECISION_OUTPUT
+#error "the renderer records the colors array, not the output pass; build it without HIGH_PRECISION_OUTPUT"
+#endif
+
+#ifdef BYTECODE_VM
+#include "vm.h"
+#endif
+
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+  Renders the show the firmware would play, as fast as the host can,
+  for reviewing hours of it at once:
+
+    render [--leds N] [--runs N] [--seed N] [--threads N] [-o FILE]
+    render --bench [--leds N] [--runs N]
+
+  The show is split into pattern runs (one pattern from its first to
+  its last frame).  Every run starts from state that only depends on
+  the show seed and its run number (see startPattern() in main.cpp and
+  prng.h), so the runs are rendered independently, in parallel, each
+  thread with its own copy of the show state (SHOW_STATE).  Each thread
+  takes runs from its own queue and steals from the other threads'
+  queues when its own is empty, so threads that draw short runs (or
+  the slow Collision pattern) do not sit idle.
+
+  FILE gets every frame in order.  If its name ends in .ppm it is an
+  image with one row of pixels per frame; otherwise it is a .leds file:
+  "LEDS", the number of LEDs (2 bytes), the number of frames (4 bytes),
+  then for every frame its duration in milliseconds (1 byte) and the
+  red, green, blue bytes of each LED; numbers are little-endian.
+
+  --bench renders the same runs with 1, 2, 4 and 8 threads, checks that
+  they all give the same frames and prints the speedup.
+*/
+
+// show state and pattern code in main.cpp
+extern SHOW_STATE unsigned int loopCount;
+extern SHOW_STATE unsigned int seed;
+extern SHOW_STATE unsigned int patternRun;
+extern SHOW_STATE unsigned char pattern;
+extern SHOW_STATE unsigned int maxLoops;
+void startPattern();
+unsigned char patternAfter(unsigned char p);
+unsigned char showPattern(CRGB colors[], int numLeds);
+
+struct RenderRun {
+  unsigned char pattern;
+  unsigned int number;
+  std::vector<uint8_t> frames;  // duration and colors of each frame
+  unsigned long frameCount;
+  unsigned long milliseconds;  // total duration of the frames
+  unsigned char done;
+};
+
+struct RenderQueue {
+  std::mutex lock;
+  std::deque<RenderRun *> runs;
+};
+
+static int numLeds = NUM_LEDS;
+static unsigned int showSeed = 1;
+static std::mutex doneLock;
+static std::condition_variable runDone;
+
+
+// Helper function that renders one pattern run, frame by frame, the
+// way loop() in main.cpp would show it.
+static void renderRun(RenderRun *run) {
+  std::vector<CRGB> colors(numLeds);
+  seed = showSeed;
+  pattern = run->pattern;
+  patternRun = run->number;
+  startPattern();
+
+  run->frameCount = 0;
+  run->milliseconds = 0;
+  do {
+    if (loopCount == 0) {
+      for (int i = 0; i < numLeds; i++) {
+        colors[i] = CRGB(0, 0, 0);
+      }
+    }
+    uint8_t duration = 1000 / FRAMES_PER_SECOND + showPattern(colors.data(), numLeds);
+    run->frames.push_back(duration);
+    run->frames.insert(run->frames.end(), (uint8_t *)colors.data(), (uint8_t *)colors.data() + 3*numLeds);
+    run->frameCount++;
+    run->milliseconds += duration;
+    loopCount++;
+  } while (loopCount < maxLoops);
+}
+
+
+// Helper function that returns the next run for a worker thread: the
+// oldest in its own queue, or else the newest in another thread's
+// queue.  Returns NULL when there is nothing left to render.
+static RenderRun *takeRun(std::vector<RenderQueue> &queues, unsigned int worker) {
+  for (unsigned int k = 0; k < queues.size(); k++) {
+    RenderQueue &queue = queues[(worker + k) % queues.size()];
+    std::lock_guard<std::mutex> hold(queue.lock);
+    if (!queue.runs.empty()) {
+      RenderRun *run;
+      if (k == 0) {
+        run = queue.runs.front();
+        queue.runs.pop_front();
+      }
+      else {
+        run = queue.runs.back();
+        queue.runs.pop_back();
+      }
+      return run;
+    }
+  }
+  return NULL;
+}
+
+
+static void renderWorker(std::vector<RenderQueue> *queues, unsigned int worker) {
+  #ifdef BYTECODE_VM
+    vmBegin();  // the loaded program is per thread too
+  #endif
+  RenderRun *run;
+  while ((run = takeRun(*queues, worker)) != NULL) {
+    renderRun(run);
+    std::lock_guard<std::mutex> hold(doneLock);
+    run->done = 1;
+    runDone.notify_all();
+  }
+}
+
+
+// Helper function that writes a little-endian number of the given
+// number of bytes.
+static void writeNumber(FILE *file, unsigned long value, unsigned char bytes) {
+  for (unsigned char i = 0; i < bytes; i++) {
+    fputc((value >> (8*i)) & 0xFF, file);
+  }
+}
+
+
+// Helper function that renders the given runs with the given number of
+// threads, writing the frames to file (if not NULL) as soon as all the
+// runs before them are done, and returns a checksum of all the frames.
+static uint32_t renderShow(std::vector<RenderRun> &runs, unsigned int threads, FILE *file, unsigned char ppm) {
+  std::vector<RenderQueue> queues(threads);
+  for (unsigned int i = 0; i < runs.size(); i++) {
+    runs[i].frames.clear();
+    runs[i].done = 0;
+    queues[i % threads].runs.push_back(&runs[i]);
+  }
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < threads; t++) {
+    workers.push_back(std::thread(renderWorker, &queues, t));
+  }
+
+  uint32_t checksum = 2166136261u;  // FNV-1a
+  unsigned long frames = 0;
+  for (unsigned int i = 0; i < runs.size(); i++) {
+    {
+      std::unique_lock<std::mutex> hold(doneLock);
+      runDone.wait(hold, [&] { return runs[i].done; });
+    }
+    const std::vector<uint8_t> &data = runs[i].frames;
+    for (unsigned long j = 0; j < data.size(); j++) {
+      checksum = (checksum ^ data[j]) * 16777619u;
+    }
+    if (file != NULL) {
+      for (unsigned long f = 0; f < runs[i].frameCount; f++) {
+        const uint8_t *frame = &data[f * (1 + 3*numLeds)];
+        if (!ppm) {
+          fputc(frame[0], file);
+        }
+        fwrite(frame + 1, 1, 3*numLeds, file);
+      }
+    }
+    frames += runs[i].frameCount;
+    std::vector<uint8_t>().swap(runs[i].frames);  // written; free it
+  }
+  for (unsigned int t = 0; t < threads; t++) {
+    workers[t].join();
+  }
+
+  if (file != NULL) {
+    // the frame count is only known now; the headers left room for it
+    if (ppm) {
+      fseek(file, 0, SEEK_SET);
+      fprintf(file, "P6\n%d %10lu\n255\n", numLeds, frames);
+    }
+    else {
+      fseek(file, 6, SEEK_SET);
+      writeNumber(file, frames, 4);
+    }
+  }
+  return checksum;
+}
+
+
+static void usage() {
+  fprintf(stderr,
+    "usage: render [--leds N] [--runs N] [--seed N] [--threads N] [-o FILE]\n"
+    "       render --bench [--leds N] [--runs N] [--seed N]\n");
+  exit(2);
+}
+
+
+int main(int argc, char **argv) {
+  unsigned int numRuns = 100;
+  unsigned int threads = std::thread::hardware_concurrency();
+  unsigned char bench = 0;
+  std::string output = "show.leds";
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--bench") {
+      bench = 1;
+    }
+    else if (i + 1 >= argc) {
+      usage();
+    }
+    else if (arg == "--leds") {
+      numLeds = atoi(argv[++i]);
+    }
+    else if (arg == "--runs") {
+      numRuns = atoi(argv[++i]);
+    }
+    else if (arg == "--seed") {
+      showSeed = atoi(argv[++i]);
+    }
+    else if (arg == "--threads") {
+      threads = atoi(argv[++i]);
+    }
+    else if (arg == "-o") {
+      output = argv[++i];
+    }
+    else {
+      usage();
+    }
+  }
+  if (numLeds < 8 || numLeds > 65535 || numRuns == 0) {
+    fprintf(stderr, "render: need 8 to 65535 LEDs and at least one run\n");
+    return 2;
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+
+  // the patterns cycle in the same order as on the strip, starting
+  // from the one the firmware starts with
+  std::vector<RenderRun> runs(numRuns);
+  unsigned char p = pattern;
+  for (unsigned int i = 0; i < numRuns; i++) {
+    runs[i].pattern = p;
+    runs[i].number = i;
+    p = patternAfter(p);
+  }
+
+  if (bench) {
+    printf("%u runs of %d LEDs on %u hardware threads\n", numRuns, numLeds,
+      std::thread::hardware_concurrency());
+    printf("threads  seconds  frames/s  speedup\n");
+    double single = 0;
+    uint32_t expected = 0;
+    const unsigned int counts[] = { 1, 2, 4, 8 };
+    for (unsigned int c = 0; c < 4; c++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      uint32_t checksum = renderShow(runs, counts[c], NULL, 0);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      unsigned long frames = 0;
+      for (unsigned int i = 0; i < numRuns; i++) {
+        frames += runs[i].frameCount;
+      }
+      if (c == 0) {
+        single = seconds;
+        expected = checksum;
+      }
+      printf("%7u  %7.3f  %8.0f  %6.2fx%s\n", counts[c], seconds, frames / seconds,
+        single / seconds, checksum == expected ? "" : "  (frames differ!)");
+      if (checksum != expected) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  unsigned char ppm = output.size() > 4 && output.compare(output.size() - 4, 4, ".ppm") == 0;
+  FILE *file = fopen(output.c_str(), "wb");
+  if (file == NULL) {
+    perror(output.c_str());
+    return 1;
+  }
+  if (ppm) {
+    fprintf(file, "P6\n%d %10lu\n255\n", numLeds, 0UL);
+  }
+  else {
+    fwrite("LEDS", 1, 4, file);
+    writeNumber(file, numLeds, 2);
+    writeNumber(file, 0, 4);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  renderShow(runs, threads, file, ppm);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fclose(file);
+
+  unsigned long frames = 0;
+  unsigned long milliseconds = 0;
+  for (unsigned int i = 0; i < numRuns; i++) {
+    frames += runs[i].frameCount;
+    milliseconds += runs[i].milliseconds;
+  }
+  printf("%s: %lu frames (%lu:%02lu:%02lu of show) in %.2f s on %u threads\n", output.c_str(),
+    frames, milliseconds / 3600000, milliseconds / 60000 % 60, milliseconds / 1000 % 60,
+    seconds, threads);
+  return 0;
+}
+
+#endif
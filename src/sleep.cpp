@@ -0,0 +1,80 @@
+#include <Arduino.h>
+#include "sleep.h"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#else
+#include <time.h>
+#endif
+
+static unsigned long frameStart = 0;
+static unsigned long activeMicros = 0;
+static unsigned long idleMicros = 0;
+static volatile unsigned char inputChanged = 0;
+
+
+#ifdef __AVR__
+// Interrupt handler for the button and switch pins; besides waking up
+// the MCU, it tells idleSleepUntilNextFrame() to stop sleeping.
+static void wake() {
+  inputChanged = 1;
+}
+#endif
+
+
+void idleSleepBegin(uint8_t buttonPin, uint8_t switchPin) {
+  #ifdef __AVR__
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    attachInterrupt(digitalPinToInterrupt(buttonPin), wake, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(switchPin), wake, CHANGE);
+  #else
+    (void)buttonPin;
+    (void)switchPin;
+  #endif
+  frameStart = micros();
+}
+
+
+void idleSleepUntilNextFrame(unsigned long periodMicros) {
+  unsigned long now = micros();
+  activeMicros += now - frameStart;
+  inputChanged = 0;
+
+  if (now - frameStart < periodMicros) {
+    unsigned long elapsed;
+    while (!inputChanged && (elapsed = micros() - frameStart) < periodMicros) {
+      #ifdef __AVR__
+        sleep_mode();  // woken by the timer or the button/switch
+      #else
+        // let the host's scheduler run something else for the rest of
+        // the frame instead of spinning on the clock
+        unsigned long remaining = periodMicros - elapsed;
+        struct timespec duration = { (time_t)(remaining / 1000000), (long)(remaining % 1000000) * 1000 };
+        nanosleep(&duration, NULL);
+      #endif
+    }
+    unsigned long end = micros();
+    idleMicros += end - now;
+    // keep frames on a fixed grid unless an input cut the sleep short
+    frameStart = inputChanged ? end : frameStart + periodMicros;
+  }
+  else {
+    frameStart = now;  // frame overran; start the next one now
+  }
+}
+
+
+unsigned long idleSleepActiveMicros() {
+  return activeMicros;
+}
+
+
+unsigned long idleSleepIdleMicros() {
+  return idleMicros;
+}
+
+
+void idleSleepResetStats() {
+  activeMicros = 0;
+  idleMicros = 0;
+}
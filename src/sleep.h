@@ -0,0 +1,33 @@
+#include <Arduino.h>
+
+/*
+  This function prepares the MCU for idle sleep between frames and
+  makes a change on either of the given pins (the next pattern button
+  and the autocycle switch, which must be interrupt pins) wake it up.
+  It also starts the first frame.
+*/
+void idleSleepBegin(uint8_t buttonPin, uint8_t switchPin);
+
+/*
+  This function puts the MCU in idle sleep until periodMicros have
+  passed since the start of the current frame, then starts the next
+  frame.  It returns early if the button or switch changes state.  If
+  the frame already took longer than periodMicros it returns right
+  away and the next frame starts now (late frames are not caught up).
+  On AVR, idle sleep is also ended by the millis() timer interrupt
+  every 1.024 ms, so the MCU sleeps in short stretches and checks the
+  time after each one.  On other targets the thread sleeps with
+  nanosleep() for the rest of the frame.
+  The time from the start of the frame to the call is counted as
+  active time, and the rest of the frame as sleep time.
+*/
+void idleSleepUntilNextFrame(unsigned long periodMicros);
+
+/*
+  These functions return the active and sleep time, in microseconds,
+  accumulated since the last call to idleSleepResetStats(); the duty
+  cycle is active / (active + sleep).
+*/
+unsigned long idleSleepActiveMicros();
+unsigned long idleSleepIdleMicros();
+void idleSleepResetStats();
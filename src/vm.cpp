@@ -0,0 +1,347 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include "constants.h"
+#include "patterns.h"
+#include "prng.h"
+#include "vm.h"
+
+#ifdef HAS_EEPROM
+#include <EEPROM.h>
+#endif
+
+const unsigned char VM_FRAME_START = 0xA5;  // first byte of a serial program frame
+const unsigned char VM_REPLY_READY = 0x11;  // DC1: send the rest of the frame
+const unsigned char VM_REPLY_OK = 0x06;  // ACK: program received and loaded
+const unsigned char VM_REPLY_BAD = 0x15;  // NAK: bad length or checksum, or timed out
+const unsigned char VM_NUM_REGISTERS = 8;
+const unsigned char VM_PALETTE_SIZE = 8;
+
+// steps charged for an instruction on top of the one every instruction
+// costs, for the ones that do several times the work of the simplest
+// (see VM_STEP_LIMIT)
+const unsigned char VM_RANDOM_STEPS = 3;  // each prngRandom() call
+const unsigned char VM_BLEND_STEPS = 2;  // nblend() of three channels
+const unsigned char VM_DIVIDE_STEPS = 2;  // a % by an operand (MODI, SEL)
+
+// Default program, used until a valid one is stored in EEPROM: every
+// LED fades, and each frame one random LED lights up in a random
+// color from a red/green/gold palette.  Source:
+//   PAL 0 180 0 0
+//   PAL 1 0 180 0
+//   PAL 2 160 120 20
+//   EACH
+//   FADE 7 4
+//   NEXT
+//   PICK
+//   RND r0 3
+//   PALR r0
+//   END
+const unsigned char defaultProgram[] PROGMEM = {
+  VM_PAL, 0, 180, 0, 0,
+  VM_PAL, 1, 0, 180, 0,
+  VM_PAL, 2, 160, 120, 20,
+  VM_EACH,
+  VM_FADE, 7, 4,
+  VM_NEXT,
+  VM_PICK,
+  VM_RND, 0, 3,
+  VM_PALR, 0,
+  VM_END
+};
+
+// the loaded program; the padding past VM_MAX_PROGRAM is always zero
+// (VM_END) so that reading the operands of a truncated instruction at
+// the end of the program is harmless.  Programs read from EEPROM or
+// received over serial are read straight into it, with programLength
+// 0 (no program) until they have been checked.
+static SHOW_STATE unsigned char program[VM_MAX_PROGRAM + 5];
+static SHOW_STATE unsigned char programLength = 0;
+static SHOW_STATE unsigned char reg[VM_NUM_REGISTERS];
+static SHOW_STATE CRGB palette[VM_PALETTE_SIZE];
+
+
+// Helper function that returns the checksum used for stored and
+// received programs: the low byte of the sum of the program bytes.
+static unsigned char vmChecksum(const unsigned char *bytes, unsigned char length) {
+  unsigned char sum = 0;
+  for (unsigned char i = 0; i < length; i++) {
+    sum += bytes[i];
+  }
+  return sum;
+}
+
+
+void vmReset() {
+  memset(reg, 0, sizeof(reg));
+  for (unsigned char i = 0; i < VM_PALETTE_SIZE; i++) {
+    palette[i] = CRGB(0, 0, 0);
+  }
+}
+
+
+void vmBegin() {
+  memset(program, 0, sizeof(program));
+  programLength = 0;
+  vmReset();
+
+  #ifdef HAS_EEPROM
+    // stored layout: length, program bytes, checksum
+    unsigned char storedLength = EEPROM.read(VM_EEPROM_ADDR);
+    if (storedLength > 0 && storedLength <= VM_MAX_PROGRAM) {
+      for (unsigned char i = 0; i < storedLength; i++) {
+        program[i] = EEPROM.read(VM_EEPROM_ADDR + 1 + i);
+      }
+      if (EEPROM.read(VM_EEPROM_ADDR + 1 + storedLength) == vmChecksum(program, storedLength)) {
+        programLength = storedLength;
+        return;
+      }
+      memset(program, 0, sizeof(program));
+    }
+  #endif
+
+  for (unsigned char i = 0; i < sizeof(defaultProgram); i++) {
+    program[i] = pgm_read_byte(&defaultProgram[i]);
+  }
+  programLength = sizeof(defaultProgram);
+}
+
+
+// Helper function that applies fade() or randomWalk() to the channels
+// of an LED selected by a channel mask (1 = red, 2 = green, 4 = blue).
+static void vmFadeMasked(CRGB *led, unsigned char mask, unsigned char fadeTime) {
+  for (unsigned char ch = 0; ch < 3; ch++) {
+    if (mask & (1 << ch)) {
+      fade(&(*led)[ch], fadeTime);
+    }
+  }
+}
+
+static void vmWalkMasked(CRGB *led, unsigned char mask, unsigned char maxVal,
+ unsigned char changeAmount, unsigned char directions) {
+  for (unsigned char ch = 0; ch < 3; ch++) {
+    if (mask & (1 << ch)) {
+      randomWalk(&(*led)[ch], maxVal, changeAmount, directions);
+    }
+  }
+}
+
+
+// Helper function that returns the number of channels selected by a
+// channel mask.
+static unsigned char vmMaskChannels(unsigned char mask) {
+  return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1);
+}
+
+
+void vmRun(CRGB colors[], int numLeds, unsigned int loopCount) {
+  unsigned char pc = 0;
+  unsigned char loopStart = 0;  // first instruction of the EACH loop body
+  int led = 0;  // current LED
+  unsigned int steps = 0;  // cost of the instructions run so far this frame
+
+  while (pc < programLength) {
+    // stop a program that has used up its steps for this frame; the
+    // count does not depend on how fast the host is, so a stopped
+    // frame is the same on the strip and in the offline renderer
+    if (steps >= VM_STEP_LIMIT) {
+      return;
+    }
+    steps++;
+    unsigned char *op = &program[pc];
+    CRGB *current = &colors[led];
+    // operand register numbers are masked so they can never index
+    // outside the register file
+    unsigned char *r = &reg[op[1] & (VM_NUM_REGISTERS - 1)];
+    unsigned char *s = &reg[op[2] & (VM_NUM_REGISTERS - 1)];
+
+    switch (op[0]) {
+      case VM_LDI:
+        *r = op[2];
+        pc += 3;
+        break;
+      case VM_LDL:
+        *r = loopCount;
+        pc += 2;
+        break;
+      case VM_LDX:
+        *r = led;
+        pc += 2;
+        break;
+      case VM_ADD:
+        *r += *s;
+        pc += 3;
+        break;
+      case VM_ADDI:
+        *r += op[2];
+        pc += 3;
+        break;
+      case VM_MODI:
+        if (op[2]) {
+          *r %= op[2];
+        }
+        steps += VM_DIVIDE_STEPS;
+        pc += 3;
+        break;
+      case VM_RND:
+        *r = prngRandom(op[2]);
+        steps += VM_RANDOM_STEPS;
+        pc += 3;
+        break;
+      case VM_JNZ:
+        pc += 3;
+        if (*r) {
+          pc += (signed char)op[2];
+        }
+        break;
+      case VM_JMP:
+        pc += 2 + (signed char)op[1];
+        break;
+      case VM_EACH:
+        pc += 1;
+        led = 0;
+        loopStart = pc;
+        break;
+      case VM_NEXT:
+        pc += 1;
+        if (++led < numLeds) {
+          pc = loopStart;
+        }
+        else {
+          led = 0;
+        }
+        break;
+      case VM_PICK:
+        led = prngRandom(numLeds);
+        steps += VM_RANDOM_STEPS;
+        pc += 1;
+        break;
+      case VM_SEL:
+        led = *r % numLeds;
+        steps += VM_DIVIDE_STEPS;
+        pc += 2;
+        break;
+      case VM_GET:
+        *r = op[2] < 3 ? (*current)[op[2]] : 0;
+        pc += 3;
+        break;
+      case VM_PUT:
+        if (op[1] < 3) {
+          (*current)[op[1]] = *s;
+        }
+        pc += 3;
+        break;
+      case VM_FADE:
+        vmFadeMasked(current, op[1], op[2]);
+        steps += vmMaskChannels(op[1]) >> 1;
+        pc += 3;
+        break;
+      case VM_WALK:
+        vmWalkMasked(current, op[1], op[2], op[3], op[4]);
+        steps += (1 + VM_RANDOM_STEPS) * vmMaskChannels(op[1]);
+        pc += 5;
+        break;
+      case VM_RGB:
+        *current = CRGB(op[1], op[2], op[3]);
+        pc += 4;
+        break;
+      case VM_PAL:
+        palette[op[1] & (VM_PALETTE_SIZE - 1)] = CRGB(op[2], op[3], op[4]);
+        pc += 5;
+        break;
+      case VM_PALR:
+        *current = palette[*r & (VM_PALETTE_SIZE - 1)];
+        pc += 2;
+        break;
+      case VM_BLEND:
+        nblend(*current, palette[op[1] & (VM_PALETTE_SIZE - 1)], op[2]);
+        steps += VM_BLEND_STEPS;
+        pc += 3;
+        break;
+      case VM_COPY:
+        if (led >= op[1]) {
+          *current = colors[led - op[1]];
+        }
+        pc += 2;
+        break;
+      case VM_DIM:
+        current->red >>= op[1] & 7;
+        current->green >>= op[1] & 7;
+        current->blue >>= op[1] & 7;
+        pc += 2;
+        break;
+      default:  // VM_END or an unknown opcode
+        return;
+    }
+  }
+}
+
+
+// Helper function that waits up to VM_RX_TIMEOUT_MS for the next byte
+// on the serial port and returns it, or returns -1 if none arrives.
+static int vmReadByte() {
+  unsigned long start = millis();
+  while (Serial.available() <= 0) {
+    if (millis() - start >= VM_RX_TIMEOUT_MS) {
+      return -1;
+    }
+  }
+  return Serial.read();
+}
+
+
+// Helper function that receives the rest of a program frame once its
+// start byte has been read.  The program is received straight into
+// program[] and only saved to EEPROM once its checksum matches, so a
+// bad frame puts the stored (or default) program back with vmBegin().
+// It returns 1 if the new program was loaded, and 0 otherwise.
+static unsigned char vmReceiveFrame() {
+  // the sender waits for this before sending the rest of the frame, and
+  // it is read here as it arrives, so it cannot overflow the UART's
+  // 64-byte receive buffer however long the frames of the show are
+  Serial.write(VM_REPLY_READY);
+
+  int length = vmReadByte();
+  if (length <= 0 || length > VM_MAX_PROGRAM) {
+    Serial.write(VM_REPLY_BAD);
+    return 0;
+  }
+  memset(program, 0, sizeof(program));
+  programLength = 0;
+  for (unsigned char i = 0; i < length; i++) {
+    int c = vmReadByte();
+    if (c < 0) {
+      vmBegin();
+      Serial.write(VM_REPLY_BAD);
+      return 0;
+    }
+    program[i] = c;
+  }
+  int checksum = vmReadByte();
+  if (checksum != vmChecksum(program, length)) {
+    vmBegin();
+    Serial.write(VM_REPLY_BAD);
+    return 0;
+  }
+
+  #ifdef HAS_EEPROM
+    EEPROM.update(VM_EEPROM_ADDR, length);
+    for (unsigned char i = 0; i < length; i++) {
+      EEPROM.update(VM_EEPROM_ADDR + 1 + i, program[i]);
+    }
+    EEPROM.update(VM_EEPROM_ADDR + 1 + length, checksum);
+  #endif
+  programLength = length;
+  vmReset();
+  Serial.write(VM_REPLY_OK);
+  return 1;
+}
+
+
+unsigned char vmPollSerial() {
+  while (Serial.available() > 0) {
+    if (Serial.read() == VM_FRAME_START) {
+      return vmReceiveFrame();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include "FastLED.h"
+
+/*
+  Instruction set of the pattern virtual machine.  Every instruction is
+  one opcode byte followed by its operand bytes (listed after each
+  opcode below).  Operands named r or s are register numbers (0-7),
+  mask is a channel mask (1 = red, 2 = green, 4 = blue), ch is a
+  channel number (0 = red, 1 = green, 2 = blue), p is a palette entry
+  (0-7) and rel is a signed jump offset relative to the next
+  instruction.  LED instructions operate on the current LED, which is
+  set by EACH/NEXT, PICK or SEL.
+  tools/vmasm.py assembles text programs into this format and must be
+  kept in sync with it.
+*/
+enum VmOpcode {
+  VM_END = 0,     //                      stop running this frame
+  VM_LDI = 1,     // r imm                r = imm
+  VM_LDL = 2,     // r                    r = low byte of loopCount
+  VM_LDX = 3,     // r                    r = index of the current LED
+  VM_ADD = 4,     // r s                  r = r + s
+  VM_ADDI = 5,    // r imm                r = r + imm
+  VM_MODI = 6,    // r imm                r = r % imm
+  VM_RND = 7,     // r imm                r = random(imm)
+  VM_JNZ = 8,     // r rel                jump by rel if r is not 0
+  VM_JMP = 9,     // rel                  jump by rel
+  VM_EACH = 10,   //                      start a loop over all LEDs
+  VM_NEXT = 11,   //                      end of the loop started by EACH
+  VM_PICK = 12,   //                      current LED = random LED
+  VM_SEL = 13,    // r                    current LED = r % numLeds
+  VM_GET = 14,    // r ch                 r = channel ch of current LED
+  VM_PUT = 15,    // ch r                 channel ch of current LED = r
+  VM_FADE = 16,   // mask fadeTime        fade() the masked channels
+  VM_WALK = 17,   // mask max step dirs   randomWalk() the masked channels
+  VM_RGB = 18,    // red green blue       set current LED to a color
+  VM_PAL = 19,    // p red green blue     set palette entry p to a color
+  VM_PALR = 20,   // r                    set current LED to palette entry r
+  VM_BLEND = 21,  // p amount             blend current LED towards palette entry p
+  VM_COPY = 22,   // offset               copy the color of the LED offset LEDs back
+  VM_DIM = 23,    // shift                shift all channels right by shift
+  NUM_VM_OPCODES = 24
+};
+
+/*
+  This function loads the stored pattern program: the one in EEPROM
+  if a valid one has been saved there, otherwise the default program
+  compiled into flash.  It also clears the registers and palette.
+*/
+void vmBegin();
+
+/*
+  This function clears the registers and palette, so that every run of
+  the pattern starts the program from the same state.
+*/
+void vmReset();
+
+/*
+  This function runs the loaded program once, which renders one frame
+  into the colors array.  The registers and palette keep their values
+  from one frame to the next.  Each instruction costs one step, plus
+  a few more for those that draw random numbers, divide, blend or
+  work on several channels, and a program that uses up VM_STEP_LIMIT
+  steps in one frame is stopped there, so that a bad or too slow
+  program cannot hang the main loop or make the frame late.  Since the
+  limit counts instructions rather than time, a stopped frame renders
+  the same on any host, including the offline renderer.
+*/
+void vmRun(CRGB colors[], int numLeds, unsigned int loopCount);
+
+/*
+  This function checks the serial port for a program frame:
+    0xA5, length, length program bytes, checksum
+  where the checksum is the low byte of the sum of the program bytes.
+  Bytes before the 0xA5 are skipped without waiting.  Once the 0xA5
+  has arrived it replies 0x11 (ready), and the sender must wait for
+  that before sending the rest, which is then received right away,
+  waiting up to VM_RX_TIMEOUT_MS for each byte.  If the frame is valid
+  the program is saved to EEPROM (when available) and loaded, 0x06 is
+  replied and 1 is returned; otherwise the stored program is loaded
+  again as by vmBegin(), 0x15 is replied and 0 is returned.
+  Receiving a frame stalls the show for about 12 ms.
+*/
+unsigned char vmPollSerial();
@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <unity.h>
+#include "audio.h"
+
+// Offline checks and benchmark of the audio stage (src/audio.h), fed
+// from a WAV file the way the native build feeds it: a tone burst in
+// each band between stretches of silence, analyzed in 8 ms frames.
+
+const unsigned int WAV_RATE = 44100;
+const unsigned int FRAME_SAMPLES = AUDIO_SAMPLE_RATE * 8 / 1000;  // one 8 ms frame
+
+static char wavPath[] = "/tmp/test_audioXXXXXX";
+
+
+static void putNumber(FILE *file, unsigned long value, unsigned char bytes) {
+  for (unsigned char i = 0; i < bytes; i++) {
+    fputc((value >> (8*i)) & 0xFF, file);
+  }
+}
+
+
+// writes a 16-bit mono WAV file: silence, then toneSeconds of a tone at
+// toneHz, then silence again
+static void writeWav(const char *path, float silenceSeconds, float toneSeconds, float toneHz) {
+  unsigned long frames = (2*silenceSeconds + toneSeconds) * WAV_RATE;
+  FILE *file = fopen(path, "wb");
+  fwrite("RIFF", 1, 4, file);
+  putNumber(file, 36 + 2*frames, 4);
+  fwrite("WAVEfmt ", 1, 8, file);
+  putNumber(file, 16, 4);
+  putNumber(file, 1, 2);  // PCM
+  putNumber(file, 1, 2);  // mono
+  putNumber(file, WAV_RATE, 4);
+  putNumber(file, 2*WAV_RATE, 4);
+  putNumber(file, 2, 2);
+  putNumber(file, 16, 2);
+  fwrite("data", 1, 4, file);
+  putNumber(file, 2*frames, 4);
+  for (unsigned long n = 0; n < frames; n++) {
+    float t = (float)n / WAV_RATE;
+    float v = 0;
+    if (t >= silenceSeconds && t < silenceSeconds + toneSeconds) {
+      v = 12000 * sinf(2 * (float)M_PI * toneHz * t);
+    }
+    putNumber(file, (uint16_t)(int16_t)v, 2);
+  }
+  fclose(file);
+}
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// lets the envelopes decay to silence and leaves the ring empty
+static void settle() {
+  for (unsigned int n = 0; n < 20000; n++) {
+    audioAddSample(512);
+    if (n % FRAME_SAMPLES == 0) {
+      audioUpdate();
+    }
+  }
+  for (unsigned int n = 0; n < 300; n++) {
+    audioAddSample(512);  // overflow the ring, so that the next update empties it
+  }
+  audioUpdate();
+}
+
+
+void setUp() {
+  int fd = mkstemp(wavPath);
+  close(fd);
+}
+
+
+void tearDown() {
+  unlink(wavPath);
+  strcpy(wavPath, "/tmp/test_audioXXXXXX");
+}
+
+
+void test_wav_is_resampled_to_the_adc_rate() {
+  writeWav(wavPath, 0.5, 1, 150);
+  const uint16_t *samples;
+  unsigned long length = audioReadWav(wavPath, &samples);
+  TEST_ASSERT_UINT_WITHIN(2, 2 * AUDIO_SAMPLE_RATE, length);
+  TEST_ASSERT_EQUAL(512, samples[0]);  // silence sits at the bias voltage
+  unsigned int lowest = 1023;
+  unsigned int highest = 0;
+  for (unsigned long n = 0; n < length; n++) {
+    lowest = samples[n] < lowest ? samples[n] : lowest;
+    highest = samples[n] > highest ? samples[n] : highest;
+  }
+  TEST_ASSERT_UINT_WITHIN(4, 512 - 187, lowest);  // 12000 / 64 = 187
+  TEST_ASSERT_UINT_WITHIN(4, 512 + 187, highest);
+  TEST_ASSERT_EQUAL(0, audioReadWav("/nonexistent.wav", &samples));
+}
+
+
+void test_every_complete_block_is_analyzed() {
+  settle();
+  for (unsigned int n = 0; n < 100; n++) {
+    audioAddSample(512);
+  }
+  TEST_ASSERT_EQUAL(1, audioUpdate());  // 64 of the 100
+  for (unsigned int n = 0; n < 92; n++) {
+    audioAddSample(512);
+  }
+  TEST_ASSERT_EQUAL(2, audioUpdate());  // the other 36 and these 92
+  TEST_ASSERT_EQUAL(0, audioUpdate());
+}
+
+
+void test_overrun_resynchronizes() {
+  settle();
+  // a stall of 300 samples (31 ms) overflows the 128-sample ring
+  for (unsigned int n = 0; n < 300; n++) {
+    audioAddSample(512);
+  }
+  TEST_ASSERT_EQUAL(0, audioUpdate());  // the stale samples are dropped
+  for (unsigned int n = 0; n < 64; n++) {
+    audioAddSample(512);
+  }
+  TEST_ASSERT_EQUAL(1, audioUpdate());  // and fresh blocks are analyzed again
+}
+
+
+// Feeds the WAV file in 8 ms frames and reports how long after the tone
+// starts each band's envelope reaches half its level during the tone,
+// and what audioUpdate() costs per frame on this host.
+static void benchmarkTone(float toneHz, unsigned char band, const char *name) {
+  const float silence = 0.5;
+  writeWav(wavPath, silence, 1, toneHz);
+  const uint16_t *samples;
+  unsigned long length = audioReadWav(wavPath, &samples);
+  settle();
+
+  unsigned long onset = silence * AUDIO_SAMPLE_RATE;
+  unsigned long frames = length / FRAME_SAMPLES;
+  unsigned char *envelopes = new unsigned char[frames * NUM_AUDIO_BANDS];
+  unsigned long long nanos = 0;
+  for (unsigned long f = 0; f < frames; f++) {
+    for (unsigned int n = 0; n < FRAME_SAMPLES; n++) {
+      audioAddSample(samples[f * FRAME_SAMPLES + n]);
+    }
+    unsigned long long start = nowNanos();
+    audioUpdate();
+    nanos += nowNanos() - start;
+    for (unsigned char b = 0; b < NUM_AUDIO_BANDS; b++) {
+      envelopes[f * NUM_AUDIO_BANDS + b] = audioEnvelope(b);
+    }
+  }
+
+  // steady level: the last frame of the tone
+  unsigned long toneEnd = (silence + 1) * AUDIO_SAMPLE_RATE / FRAME_SAMPLES - 1;
+  unsigned char steady = envelopes[toneEnd * NUM_AUDIO_BANDS + band];
+  unsigned char quiet = envelopes[band];
+  unsigned long reached = 0;
+  for (unsigned long f = 0; f < frames; f++) {
+    if ((f + 1) * FRAME_SAMPLES > onset && envelopes[f * NUM_AUDIO_BANDS + band] >= (quiet + steady) / 2) {
+      reached = (f + 1) * FRAME_SAMPLES;  // the envelope is read after the frame's samples
+      break;
+    }
+  }
+  float latencyMs = (reached - onset) * 1000.0f / AUDIO_SAMPLE_RATE;
+  printf("%s tone: envelope %u -> %u, half level after %.1f ms, audioUpdate %.0f ns/frame\n",
+    name, quiet, steady, latencyMs, (double)nanos / frames);
+
+  TEST_ASSERT_GREATER_THAN(quiet + 64, steady);
+  for (unsigned char b = 0; b < NUM_AUDIO_BANDS; b++) {
+    if (b != band) {
+      // the other bands stay well below the tone's band
+      TEST_ASSERT_LESS_THAN(steady - 32, envelopes[toneEnd * NUM_AUDIO_BANDS + b]);
+    }
+  }
+  // at most the rest of the block the tone starts in, two blocks of
+  // envelope attack and a frame of buffering
+  TEST_ASSERT_LESS_OR_EQUAL(3 * 64 * 1000.0f / AUDIO_SAMPLE_RATE + 8, latencyMs);
+  delete[] envelopes;
+}
+
+
+void test_bass_latency_and_cost() {
+  benchmarkTone(150, AudioBass, "bass 150 Hz");
+}
+
+
+void test_mid_latency_and_cost() {
+  benchmarkTone(600, AudioMid, "mid 600 Hz");
+}
+
+
+void test_treble_latency_and_cost() {
+  benchmarkTone(1800, AudioTreble, "treble 1.8 kHz");
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_wav_is_resampled_to_the_adc_rate);
+  RUN_TEST(test_every_complete_block_is_analyzed);
+  RUN_TEST(test_overrun_resynchronizes);
+  RUN_TEST(test_bass_latency_and_cost);
+  RUN_TEST(test_mid_latency_and_cost);
+  RUN_TEST(test_treble_latency_and_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <unity.h>
+#include "constants.h"
+#include "checkpoint.h"
+#include "output.h"
+
+// Checks that the show resumes from a checkpoint after a power cut
+// (src/checkpoint.h) the way setup() restores it, and how long it takes
+// from the start of setup() to the first frame on this host.
+
+// show state and pattern code in main.cpp
+extern CRGB colors[];
+#ifdef HIGH_PRECISION_OUTPUT
+extern CRGB16 colors16[];
+extern unsigned char showColors16;
+#endif
+extern SHOW_STATE unsigned int loopCount;
+extern SHOW_STATE unsigned char pattern;
+void startPattern();
+unsigned char showPattern(CRGB colors[], int numLeds);
+void saveCheckpoint();
+void setup();
+void loop();
+
+const unsigned char RANDOM_COLOR_WALK = 1;
+const unsigned char COLLISION = 6;
+
+static unsigned long firstShowMicros;
+
+
+static void recordShow(const CRGB leds[], int numLeds, uint8_t brightness) {
+  (void)leds;
+  (void)numLeds;
+  (void)brightness;
+  if (firstShowMicros == 0) {
+    firstShowMicros = micros();
+  }
+}
+
+
+// Helper function that runs pattern p from its start for the given
+// number of frames, checkpoints it and lets the checkpoint be written
+// the way loop() does, one byte per pass.
+static void playAndCheckpoint(unsigned char p, unsigned int frames) {
+  pattern = p;
+  startPattern();
+  for (unsigned int f = 0; f < frames; f++) {
+    if (loopCount == 0) {
+      for (int i = 0; i < NUM_LEDS; i++) {
+        colors[i] = CRGB(0, 0, 0);
+      }
+    }
+    showPattern(colors, NUM_LEDS);
+    loopCount++;
+  }
+  saveCheckpoint();
+  for (unsigned char i = 0; i < 32; i++) {
+    checkpointPoll();
+  }
+}
+
+
+// Helper function that loses everything but the EEPROM, as a power cut
+// would, boots again and shows the first frame.  It returns the time
+// from the start of setup() to that frame.
+static unsigned long powerCycle() {
+  for (int i = 0; i < NUM_LEDS; i++) {
+    colors[i] = CRGB(0, 0, 0);
+    #ifdef HIGH_PRECISION_OUTPUT
+      colors16[i].red = colors16[i].green = colors16[i].blue = 0;
+    #endif
+  }
+  pattern = 0;
+  loopCount = 0;
+  firstShowMicros = 0;
+  unsigned long start = micros();
+  setup();
+  loop();
+  return firstShowMicros - start;
+}
+
+
+// Helper function that returns the 8-bit color the last frame drew for
+// LED i, from the 16-bit frame for the patterns that draw one.
+static CRGB drawnColor(int i) {
+  #ifdef HIGH_PRECISION_OUTPUT
+    if (showColors16) {
+      return CRGB(colors16[i].red >> 8, colors16[i].green >> 8, colors16[i].blue >> 8);
+    }
+  #endif
+  return colors[i];
+}
+
+
+static unsigned int litLeds() {
+  unsigned int lit = 0;
+  for (int i = 0; i < NUM_LEDS; i++) {
+    lit += colors[i].red > 8 || colors[i].green > 8 || colors[i].blue > 8;
+  }
+  return lit;
+}
+
+
+void setUp() {
+  nativeShowHook = recordShow;
+}
+
+
+void tearDown() {
+}
+
+
+void test_resume_restores_pattern_and_time() {
+  playAndCheckpoint(RANDOM_COLOR_WALK, 200);
+  powerCycle();
+  TEST_ASSERT_EQUAL(RANDOM_COLOR_WALK, pattern);
+  TEST_ASSERT_EQUAL(201, loopCount);  // and the first frame after it is shown
+}
+
+
+void test_random_color_walk_resumes_lit() {
+  // RandomColorWalk walks the colors it finds, which are all off after
+  // a power cut; it has to set them up again
+  playAndCheckpoint(RANDOM_COLOR_WALK, 200);
+  powerCycle();
+  TEST_ASSERT_GREATER_OR_EQUAL(NUM_LEDS / 2, litLeds());
+}
+
+
+void test_collision_restarts_the_current_collision() {
+  // checkpoint the first collision while its streams are growing
+  playAndCheckpoint(COLLISION, 20);
+  powerCycle();
+  TEST_ASSERT_EQUAL(COLLISION, pattern);
+  // the streams start again from the ends of the strip, in the color of
+  // the first collision
+  TEST_ASSERT_TRUE(drawnColor(0) == CRGB(180, 0, 0));
+  TEST_ASSERT_TRUE(drawnColor(NUM_LEDS - 1) == CRGB(180, 0, 0));
+}
+
+
+void test_resume_to_first_frame_time() {
+  playAndCheckpoint(RANDOM_COLOR_WALK, 200);
+  unsigned long resumeMicros = powerCycle();
+  printf("setup() to first frame: %lu us when resuming from a checkpoint\n", resumeMicros);
+  TEST_ASSERT_LESS_THAN(5000, resumeMicros);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_resume_restores_pattern_and_time);
+  RUN_TEST(test_random_color_walk_resumes_lit);
+  RUN_TEST(test_collision_restarts_the_current_collision);
+  RUN_TEST(test_resume_to_first_frame_time);
+  return UNITY_END();
+}
@@ -0,0 +1,238 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <unity.h>
+#include "constants.h"
+#include "dmx.h"
+
+// Sends Art-Net and E1.31 packets to the DMX receiver (src/dmx.h) over
+// loopback, the way tools/dmx_send.py does, and checks what reaches the
+// colors array and the strip, and how long a packet takes to get there.
+
+// show state and main loop in main.cpp
+extern CRGB colors[];
+void setup();
+void loop();
+
+static int sender = -1;
+static struct sockaddr_in receiver;
+static uint8_t nextSequence = 1;
+static unsigned long framesShown;
+static CRGB lastShown[NUM_LEDS];
+static uint8_t lastBrightness;
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+static void countShow(const CRGB leds[], int numLeds, uint8_t brightness) {
+  memcpy(lastShown, leds, numLeds * sizeof(CRGB));
+  lastBrightness = brightness;
+  framesShown++;
+}
+
+
+// artnet_packet() in tools/dmx_send.py
+static int artnetPacket(uint8_t *packet, unsigned int universe, uint8_t sequence, const uint8_t *data, int length) {
+  memcpy(packet, "Art-Net\0", 8);
+  packet[8] = 0x00;  // opcode 0x5000 (ArtDmx), little-endian
+  packet[9] = 0x50;
+  packet[10] = 0;  // protocol version 14
+  packet[11] = 14;
+  packet[12] = sequence;
+  packet[13] = 0;  // physical port
+  packet[14] = universe & 0xFF;
+  packet[15] = universe >> 8;
+  packet[16] = length >> 8;
+  packet[17] = length & 0xFF;
+  memcpy(packet + 18, data, length);
+  return 18 + length;
+}
+
+
+// e131_packet() in tools/dmx_send.py, with only the fields the receiver
+// checks filled in
+static int e131Packet(uint8_t *packet, unsigned int universe, uint8_t sequence, const uint8_t *data, int length) {
+  memset(packet, 0, 126);
+  memcpy(packet + 4, "ASC-E1.17\0\0\0", 12);
+  packet[21] = 0x04;  // root vector: E1.31 data
+  packet[43] = 0x02;  // framing vector: DMP
+  packet[111] = sequence;
+  packet[113] = universe >> 8;
+  packet[114] = universe & 0xFF;
+  packet[117] = 0x02;  // DMP vector: set property
+  packet[123] = (length + 1) >> 8;  // the count includes the start code
+  packet[124] = (length + 1) & 0xFF;
+  memcpy(packet + 126, data, length);
+  return 126 + length;
+}
+
+
+// the sequence number after sequence, skipping 0 (which in Art-Net
+// means an unnumbered packet)
+static uint8_t sequenceAfter(uint8_t sequence) {
+  return sequence == 255 ? 1 : sequence + 1;
+}
+
+
+// Helper function that sends a packet with the next sequence number (1
+// to 255 for both protocols) and frame as its data: frame RGB LEDs set
+// to value, in red for Art-Net and in blue for E1.31.
+static void sendFrame(unsigned char artnet, unsigned int universe, uint8_t value) {
+  uint8_t data[3 * NUM_LEDS];
+  for (int i = 0; i < NUM_LEDS; i++) {
+    data[3*i] = artnet ? value : 0;
+    data[3*i + 1] = 0;
+    data[3*i + 2] = artnet ? 0 : value;
+  }
+  uint8_t packet[126 + sizeof(data)];
+  int length = artnet ? artnetPacket(packet, universe, nextSequence, data, sizeof(data))
+                      : e131Packet(packet, universe, nextSequence, data, sizeof(data));
+  nextSequence = sequenceAfter(nextSequence);
+  TEST_ASSERT_EQUAL(length, sendto(sender, packet, length, 0, (struct sockaddr *)&receiver, sizeof(receiver)));
+}
+
+
+// Helper function that polls until a packet has been applied or 100 ms
+// have passed, and returns the number of packets applied.
+static unsigned char pollFor() {
+  unsigned long start = millis();
+  unsigned char applied;
+  while ((applied = dmxPoll(colors, NUM_LEDS)) == 0 && millis() - start < 100) {
+  }
+  return applied;
+}
+
+
+void setUp() {
+  // drain anything a previous test left queued
+  delay(5);
+  dmxPoll(colors, NUM_LEDS);
+  dmxResetStats();
+}
+
+
+void tearDown() {
+}
+
+
+void test_artnet_universe_0_drives_the_strip() {
+  sendFrame(1, 0, 200);
+  TEST_ASSERT_EQUAL(1, pollFor());
+  for (int i = 0; i < NUM_LEDS; i++) {
+    TEST_ASSERT_TRUE(colors[i] == CRGB(200, 0, 0));
+  }
+}
+
+
+void test_e131_universe_1_drives_the_strip() {
+  sendFrame(0, 1, 150);
+  TEST_ASSERT_EQUAL(1, pollFor());
+  for (int i = 0; i < NUM_LEDS; i++) {
+    TEST_ASSERT_TRUE(colors[i] == CRGB(0, 0, 150));
+  }
+}
+
+
+void test_other_universes_are_ignored() {
+  // Art-Net universe 1 is the second universe, and E1.31 universe 0 is
+  // reserved
+  sendFrame(1, 1, 10);
+  sendFrame(0, 0, 10);
+  TEST_ASSERT_EQUAL(0, pollFor());
+  TEST_ASSERT_EQUAL(2, dmxGetStats()->ignored);
+  TEST_ASSERT_TRUE(colors[0] == CRGB(0, 0, 150));
+}
+
+
+void test_late_packets_are_dropped() {
+  // after a packet in sequence, send the next two in the wrong order:
+  // the late one must not overwrite the newer one (it is counted as
+  // lost when the newer one arrives, and then as late)
+  sendFrame(1, 0, 10);
+  TEST_ASSERT_EQUAL(1, pollFor());
+  dmxResetStats();
+  uint8_t late = nextSequence;
+  nextSequence = sequenceAfter(late);
+  sendFrame(1, 0, 30);
+  uint8_t after = nextSequence;
+  nextSequence = late;
+  sendFrame(1, 0, 20);
+  nextSequence = after;
+  delay(5);
+  TEST_ASSERT_EQUAL(1, dmxPoll(colors, NUM_LEDS));
+  TEST_ASSERT_TRUE(colors[0] == CRGB(30, 0, 0));
+  TEST_ASSERT_EQUAL(1, dmxGetStats()->late);
+  TEST_ASSERT_EQUAL(1, dmxGetStats()->lost);
+}
+
+
+void test_loop_shows_each_packet() {
+  framesShown = 0;
+  sendFrame(0, 1, 90);
+  delay(5);
+  loop();
+  TEST_ASSERT_EQUAL(1, framesShown);
+  TEST_ASSERT_TRUE(colors[NUM_LEDS - 1] == CRGB(0, 0, 90));
+  TEST_ASSERT_EQUAL(1, dmxGetStats()->frames);
+
+  // the controller's levels reach the strip as they are, without the
+  // gamma curve, brightness or dithering of the patterns
+  for (int i = 0; i < NUM_LEDS; i++) {
+    TEST_ASSERT_TRUE(lastShown[i] == CRGB(0, 0, 90));
+  }
+  TEST_ASSERT_EQUAL(255, lastBrightness);
+}
+
+
+// The time from sending a packet over loopback to its data being in the
+// colors array, as seen by a loop that polls continuously.
+void test_send_to_apply_latency() {
+  const unsigned int packets = 1000;
+  unsigned long long sumNanos = 0;
+  unsigned long long maxNanos = 0;
+  for (unsigned int p = 0; p < packets; p++) {
+    unsigned long long start = nowNanos();
+    sendFrame(1, 0, p);
+    TEST_ASSERT_EQUAL(1, pollFor());
+    unsigned long long nanos = nowNanos() - start;
+    sumNanos += nanos;
+    if (nanos > maxNanos) {
+      maxNanos = nanos;
+    }
+  }
+  printf("send to apply over loopback: %.1f us average, %.1f us max (%u packets)\n",
+    sumNanos / 1000.0 / packets, maxNanos / 1000.0, packets);
+  TEST_ASSERT_EQUAL(packets, dmxGetStats()->packets);
+  TEST_ASSERT_EQUAL(0, dmxGetStats()->lost);
+}
+
+
+int main() {
+  setup();  // opens the port with dmxBegin()
+  nativeShowHook = countShow;
+  sender = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(&receiver, 0, sizeof(receiver));
+  receiver.sin_family = AF_INET;
+  receiver.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  receiver.sin_port = htons(DMX_UDP_PORT);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_artnet_universe_0_drives_the_strip);
+  RUN_TEST(test_e131_universe_1_drives_the_strip);
+  RUN_TEST(test_other_universes_are_ignored);
+  RUN_TEST(test_late_packets_are_dropped);
+  RUN_TEST(test_loop_shows_each_packet);
+  RUN_TEST(test_send_to_apply_latency);
+  close(sender);
+  return UNITY_END();
+}
@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include "constants.h"
+#include "frametap.h"
+
+// Publishes frames into the frame tap (src/frametap.h) while a reader
+// thread maps the ring separately and reads it the way
+// tools/frameview.py does, and checks that the reader never keeps a
+// torn frame and that the producer counts the frames the reader misses.
+
+// longer frames than the strip's, so a copy is more likely to be caught
+// halfway
+const int TAP_LEDS = 512;
+
+struct ReaderCounts {
+  unsigned long frames;  // frames read intact
+  unsigned long rejected;  // frames whose sequence lock check failed
+  unsigned long missed;  // frames overwritten before the reader got to them
+  unsigned long torn;  // frames that passed the check but are not whole
+};
+
+static std::atomic<bool> producerDone;
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// Helper function that fills frame with a pattern that identifies its
+// number in every byte.
+static void makeFrame(CRGB frame[], uint32_t number) {
+  uint8_t value = number & 0xFF;
+  for (int i = 0; i < TAP_LEDS; i++) {
+    frame[i] = CRGB(value, value, value);
+  }
+}
+
+
+// Helper function that reads frames from the ring until the producer is
+// done and the reader has caught up, sleeping pauseMicros after each
+// pass over the new frames.  It maps the shared memory itself, as the
+// viewer would.
+static void readFrames(ReaderCounts *counts, unsigned int pauseMicros) {
+  int fd = shm_open(FRAME_TAP_NAME, O_RDWR, 0);
+  TEST_ASSERT_TRUE(fd >= 0);
+  unsigned int slotSize = sizeof(FrameTapSlot) + ((TAP_LEDS * 3 + 3) & ~3);
+  size_t size = sizeof(FrameTapHeader) + FRAME_TAP_SLOTS * slotSize;
+  uint8_t *memory = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  TEST_ASSERT_TRUE(memory != MAP_FAILED);
+  FrameTapHeader *header = (FrameTapHeader *)memory;
+  TEST_ASSERT_EQUAL(FRAME_TAP_MAGIC, __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE));
+
+  static uint8_t copy[TAP_LEDS * 3];
+  uint32_t read = 0;
+  __atomic_store_n(&header->readerAttached, 1, __ATOMIC_RELAXED);
+  for (;;) {
+    bool done = producerDone.load();
+    uint32_t written = __atomic_load_n(&header->written, __ATOMIC_ACQUIRE);
+    if (written == read) {
+      if (done) {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    if (written - read > FRAME_TAP_SLOTS) {
+      // the frames before these are gone
+      counts->missed += written - FRAME_TAP_SLOTS - read;
+      read = written - FRAME_TAP_SLOTS;
+    }
+    for (uint32_t frame = read; frame != written; frame++) {
+      FrameTapSlot *slot = (FrameTapSlot *)(memory + sizeof(FrameTapHeader)
+        + (frame % FRAME_TAP_SLOTS) * slotSize);
+      uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+      uint32_t number = slot->frame;
+      uint8_t brightness = slot->brightness;
+      memcpy(copy, (uint8_t *)slot + sizeof(FrameTapSlot), sizeof(copy));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if ((sequence & 1) || number != frame
+          || __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence) {
+        counts->rejected++;
+        continue;
+      }
+      counts->frames++;
+      bool whole = brightness == (frame & 0xFF);
+      for (unsigned int i = 0; i < sizeof(copy); i++) {
+        whole = whole && copy[i] == (frame & 0xFF);
+      }
+      counts->torn += !whole;
+    }
+    read = written;
+    __atomic_store_n(&header->read, read, __ATOMIC_RELEASE);
+    if (pauseMicros) {
+      usleep(pauseMicros);
+    }
+  }
+  __atomic_store_n(&header->readerAttached, 0, __ATOMIC_RELAXED);
+  munmap(memory, size);
+}
+
+
+// Helper function that publishes frames frames with a reader thread
+// attached, waiting pauseMicros between frames, and returns what the
+// reader saw.
+static ReaderCounts publishWithReader(uint32_t frames, unsigned int producerPauseMicros,
+ unsigned int readerPauseMicros) {
+  static CRGB frame[TAP_LEDS];
+  ReaderCounts counts = { 0, 0, 0, 0 };
+  frameTapBegin(TAP_LEDS);
+  frameTapResetStats();
+  producerDone = false;
+  std::thread reader(readFrames, &counts, readerPauseMicros);
+  usleep(1000);  // let the reader attach
+  for (uint32_t f = 0; f < frames; f++) {
+    makeFrame(frame, f);
+    frameTapPublish(frame, TAP_LEDS, f & 0xFF);
+    if (producerPauseMicros) {
+      usleep(producerPauseMicros);
+    }
+  }
+  producerDone = true;
+  reader.join();
+  printf("%lu frames published: %lu read, %lu rejected, %lu missed by the reader, %lu counted dropped\n",
+    (unsigned long)frames, counts.frames, counts.rejected, counts.missed, frameTapDroppedFrames());
+  return counts;
+}
+
+
+void setUp() {
+}
+
+
+void tearDown() {
+}
+
+
+void test_reader_never_keeps_a_torn_frame() {
+  // the producer as fast as it can go, the reader reading continuously
+  const uint32_t frames = 200000;
+  ReaderCounts counts = publishWithReader(frames, 0, 0);
+  TEST_ASSERT_EQUAL(0, counts.torn);
+  TEST_ASSERT_GREATER_THAN(0, counts.frames);
+  // every frame was read, rejected or missed
+  TEST_ASSERT_EQUAL(frames, counts.frames + counts.rejected + counts.missed);
+}
+
+
+void test_slow_reader_frames_are_counted_dropped() {
+  // a reader that looks at the ring only every 5 ms misses most frames;
+  // the producer must count them and must not wait for it
+  const uint32_t frames = 20000;
+  unsigned long long start = nowNanos();
+  ReaderCounts counts = publishWithReader(frames, 0, 5000);
+  unsigned long long nanos = nowNanos() - start;
+  TEST_ASSERT_EQUAL(0, counts.torn);
+  TEST_ASSERT_GREATER_THAN(0, frameTapDroppedFrames());
+  // a frame is counted dropped when its slot is reused before the
+  // reader marks it read: that covers every frame the reader missed or
+  // rejected, and can include one it had copied but not yet marked
+  TEST_ASSERT_LESS_OR_EQUAL(counts.missed + counts.rejected, frameTapDroppedFrames());
+  printf("publishing with a slow reader: %.0f ns/frame\n", (double)nanos / frames);
+}
+
+
+void test_reader_that_keeps_up_drops_nothing() {
+  // frames at 1 kHz leave the reader plenty of time for each one
+  ReaderCounts counts = publishWithReader(500, 1000, 0);
+  TEST_ASSERT_EQUAL(0, frameTapDroppedFrames());
+  TEST_ASSERT_EQUAL(0, counts.missed);
+  TEST_ASSERT_EQUAL(500, counts.frames + counts.rejected);
+}
+
+
+void test_publish_cost() {
+  static CRGB frame[NUM_LEDS];
+  const uint32_t frames = 100000;
+  frameTapBegin(NUM_LEDS);
+  frameTapResetStats();
+  unsigned long long start = nowNanos();
+  for (uint32_t f = 0; f < frames; f++) {
+    frameTapPublish(frame, NUM_LEDS, 255);
+  }
+  double nanos = (double)(nowNanos() - start) / frames;
+  printf("frameTapPublish: %.0f ns/frame for %d LEDs, %lu ns/frame by frameTapNanos()\n",
+    nanos, NUM_LEDS, frameTapNanos());
+
+  // the tap's own timing sees each publish, even though one takes
+  // well under a microsecond (it leaves out the loop and one clock read)
+  TEST_ASSERT_TRUE(frameTapNanos() > 0);
+  TEST_ASSERT_TRUE(frameTapNanos() <= nanos);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reader_never_keeps_a_torn_frame);
+  RUN_TEST(test_slow_reader_frames_are_counted_dropped);
+  RUN_TEST(test_reader_that_keeps_up_drops_nothing);
+  RUN_TEST(test_publish_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,308 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <time.h>
+#include <unity.h>
+#include "constants.h"
+#include "layers.h"
+#include "layout.h"
+#include "patterns.h"
+
+// Checks of the layers (src/layers.h): that a stack drawn in one pass
+// gives the same frames as drawing its layers one pass after another
+// and as the code written without layers, for Gradient and for
+// twinkles over a masked gradient, and a comparison of their cost.
+
+// src/layout_table.h is generated for 60 LEDs
+const int LAYOUT_LEDS = 60;
+const unsigned int ROUNDS = 200;  // the cost is the best of ROUNDS rounds
+const unsigned int FRAMES = 100;  // frames per round
+
+const CRGB TWINKLE_COLOR = CRGB(255, 255, 255);
+const unsigned char TWINKLE_PERIOD = 64;
+const unsigned char MASK_PERIOD = 8;
+const unsigned char MASK_LIT = 5;
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// Helper function that draws the Gradient layers one at a time, each in
+// its own pass over the colors array.
+static void sequentialGradient(CRGB colors[], int numLeds, int loopCount, unsigned char useLayout) {
+  const uint8_t *positions = useLayout ? layoutScrollMap() : NULL;
+  composite(colors, numLeds, makeStack(GradientLayer(numLeds, loopCount, positions)));
+  composite(colors, numLeds, makeStack(DimWaveLayer(numLeds, loopCount, positions)));
+}
+
+
+// Gradient as it was written before the layers: the colors and then
+// the waves of dimness, each walked in scroll order
+static void twoPassGradient(CRGB colors[], int numLeds, int loopCount) {
+  unsigned int j = 0;
+  while (j < (unsigned int)numLeds) {
+    for (int i = 0; i < 8; i++) {
+      if (j >= (unsigned int)numLeds){ break; }
+      colors[(loopCount/2 + j + numLeds)%numLeds] = CRGB(160 - 20*i, 20*i, (160 - 20*i)*20*i/160);
+      j++;
+    }
+    for (int i = 0; i < 8; i++) {
+      if (j >= (unsigned int)numLeds){ break; }
+      colors[(loopCount/2 + j + numLeds)%numLeds] = CRGB(20*i, 160 - 20*i, (160 - 20*i)*20*i/160);
+      j++;
+    }
+  }
+
+  const unsigned char fullDarkLEDs = 10;
+  const unsigned char fullBrightLEDs = 5;
+  const unsigned char cyclePeriod = 14 + fullDarkLEDs + fullBrightLEDs;
+  unsigned int extendedLEDCount = (((numLeds-1)/cyclePeriod)+1)*cyclePeriod;
+
+  j = 0;
+  while (j < extendedLEDCount) {
+    unsigned int idx;
+    for (int i = 1; i < 8; i++) {
+      idx = (j + loopCount) % extendedLEDCount;
+      if (j++ >= extendedLEDCount){ return; }
+      if (idx >= (unsigned int)numLeds){ continue; }
+      colors[idx].red >>= i;
+      colors[idx].green >>= i;
+      colors[idx].blue >>= i;
+    }
+    for (int i = 0; i < fullDarkLEDs; i++) {
+      idx = (j + loopCount) % extendedLEDCount;
+      if (j++ >= extendedLEDCount){ return; }
+      if (idx >= (unsigned int)numLeds){ continue; }
+      colors[idx] = CRGB(0, 0, 0);
+    }
+    for (int i = 0; i < 7; i++) {
+      idx = (j + loopCount) % extendedLEDCount;
+      if (j++ >= extendedLEDCount){ return; }
+      if (idx >= (unsigned int)numLeds){ continue; }
+      colors[idx].red >>= (7 - i);
+      colors[idx].green >>= (7 - i);
+      colors[idx].blue >>= (7 - i);
+    }
+    j += fullBrightLEDs;
+  }
+}
+
+
+// Helper functions that draw twinkles over a gradient lit in bands: in
+// one pass, one pass per layer, and the way it would be written without
+// the layers (the Gradient code above, then a loop for each effect).
+static void fusedStack(CRGB colors[], int numLeds, int loopCount) {
+  composite(colors, numLeds, makeStack(
+    GradientLayer(numLeds, loopCount, NULL),
+    MaskLayer(MASK_PERIOD, MASK_LIT, loopCount / 4),
+    TwinkleLayer(TWINKLE_COLOR, loopCount, TWINKLE_PERIOD, 7)));
+}
+
+static void sequentialStack(CRGB colors[], int numLeds, int loopCount) {
+  composite(colors, numLeds, makeStack(GradientLayer(numLeds, loopCount, NULL)));
+  composite(colors, numLeds, makeStack(MaskLayer(MASK_PERIOD, MASK_LIT, loopCount / 4)));
+  composite(colors, numLeds, makeStack(TwinkleLayer(TWINKLE_COLOR, loopCount, TWINKLE_PERIOD, 7)));
+}
+
+static void handWrittenStack(CRGB colors[], int numLeds, int loopCount) {
+  unsigned int j = 0;
+  while (j < (unsigned int)numLeds) {
+    for (int i = 0; i < 8; i++) {
+      if (j >= (unsigned int)numLeds){ break; }
+      colors[(loopCount/2 + j + numLeds)%numLeds] = CRGB(160 - 20*i, 20*i, (160 - 20*i)*20*i/160);
+      j++;
+    }
+    for (int i = 0; i < 8; i++) {
+      if (j >= (unsigned int)numLeds){ break; }
+      colors[(loopCount/2 + j + numLeds)%numLeds] = CRGB(20*i, 160 - 20*i, (160 - 20*i)*20*i/160);
+      j++;
+    }
+  }
+  for (int i = 0; i < numLeds; i++) {
+    if ((i + loopCount/4) % MASK_PERIOD >= MASK_LIT) {
+      colors[i] = CRGB(0, 0, 0);
+    }
+  }
+  for (int i = 0; i < numLeds; i++) {
+    uint16_t hash = (uint16_t)(i + 7) * 0x9E37;
+    hash ^= hash >> 7;
+    unsigned char age = (loopCount + hash) % TWINKLE_PERIOD;
+    if (age < 8) {
+      colors[i].red = qadd8(colors[i].red, TWINKLE_COLOR.red >> age);
+      colors[i].green = qadd8(colors[i].green, TWINKLE_COLOR.green >> age);
+      colors[i].blue = qadd8(colors[i].blue, TWINKLE_COLOR.blue >> age);
+    }
+  }
+}
+
+
+static void assertSameFrame(const CRGB a[], const CRGB b[], int numLeds) {
+  for (int i = 0; i < numLeds; i++) {
+    TEST_ASSERT_TRUE(a[i] == b[i]);
+  }
+}
+
+
+void setUp() {
+  TEST_ASSERT_TRUE(layoutMatches(LAYOUT_LEDS));
+}
+
+
+void tearDown() {
+}
+
+
+void test_fused_matches_two_pass_gradient() {
+  // every strip length up to a few wave periods, over more than a full
+  // scroll of the colors and the waves
+  CRGB fused[NUM_LEDS + 90];
+  CRGB reference[NUM_LEDS + 90];
+  for (int numLeds = 1; numLeds <= NUM_LEDS + 90; numLeds++) {
+    for (int loopCount = 0; loopCount < 400; loopCount++) {
+      gradient(fused, numLeds, loopCount);
+      twoPassGradient(reference, numLeds, loopCount);
+      assertSameFrame(fused, reference, numLeds);
+    }
+  }
+}
+
+
+void test_fused_matches_sequential_layers() {
+  CRGB fused[LAYOUT_LEDS];
+  CRGB sequential[LAYOUT_LEDS];
+  for (unsigned char useLayout = 0; useLayout < 2; useLayout++) {
+    for (int loopCount = 0; loopCount < 400; loopCount++) {
+      gradient(fused, LAYOUT_LEDS, loopCount, useLayout);
+      sequentialGradient(sequential, LAYOUT_LEDS, loopCount, useLayout);
+      assertSameFrame(fused, sequential, LAYOUT_LEDS);
+    }
+  }
+}
+
+
+void test_stack_matches_sequential_layers() {
+  CRGB fused[LAYOUT_LEDS];
+  CRGB sequential[LAYOUT_LEDS];
+  CRGB handWritten[LAYOUT_LEDS];
+  for (int loopCount = 0; loopCount < 400; loopCount++) {
+    fusedStack(fused, LAYOUT_LEDS, loopCount);
+    sequentialStack(sequential, LAYOUT_LEDS, loopCount);
+    handWrittenStack(handWritten, LAYOUT_LEDS, loopCount);
+    assertSameFrame(fused, sequential, LAYOUT_LEDS);
+    assertSameFrame(fused, handWritten, LAYOUT_LEDS);
+  }
+}
+
+
+void test_layers_do_what_they_say() {
+  const CRGB palette[3] = { CRGB(1, 0, 0), CRGB(0, 2, 0), CRGB(0, 0, 3) };
+  PaletteLayer bands(palette, 3, 4, 2);
+  TEST_ASSERT_TRUE(bands.apply(0, CRGB(9, 9, 9)) == palette[0]);  // position 2
+  TEST_ASSERT_TRUE(bands.apply(2, CRGB(9, 9, 9)) == palette[1]);  // position 4
+  TEST_ASSERT_TRUE(bands.apply(10, CRGB(9, 9, 9)) == palette[0]);  // position 12
+
+  CRGB overlay[2] = { CRGB(200, 10, 0), CRGB(0, 0, 0) };
+  OverlayLayer add(overlay);
+  TEST_ASSERT_TRUE(add.apply(0, CRGB(100, 10, 5)) == CRGB(255, 20, 5));
+  TEST_ASSERT_TRUE(add.apply(1, CRGB(100, 10, 5)) == CRGB(100, 10, 5));
+
+  FadeLayer fader(2);
+  unsigned char expected = 100;
+  fade(&expected, 2);
+  TEST_ASSERT_TRUE(fader.apply(0, CRGB(100, 100, 100)) == CRGB(expected, expected, expected));
+
+  MaskLayer mask(4, 1, 1);
+  TEST_ASSERT_TRUE(mask.apply(3, CRGB(5, 5, 5)) == CRGB(5, 5, 5));
+  TEST_ASSERT_TRUE(mask.apply(0, CRGB(5, 5, 5)) == CRGB(0, 0, 0));
+
+  // every LED twinkles once a period, at full color, then halves
+  for (int i = 0; i < LAYOUT_LEDS; i++) {
+    unsigned char lit = 0;
+    for (unsigned int loopCount = 0; loopCount < TWINKLE_PERIOD; loopCount++) {
+      TwinkleLayer twinkles(CRGB(128, 64, 32), loopCount, TWINKLE_PERIOD, 7);
+      CRGB c = twinkles.apply(i, CRGB(0, 0, 0));
+      if (c == CRGB(128, 64, 32)) {
+        lit++;
+        TwinkleLayer next(CRGB(128, 64, 32), loopCount + 1, TWINKLE_PERIOD, 7);
+        TEST_ASSERT_TRUE(next.apply(i, CRGB(0, 0, 0)) == CRGB(64, 32, 16));
+      }
+    }
+    TEST_ASSERT_EQUAL(1, lit);
+  }
+}
+
+
+typedef void (*DrawFunction)(CRGB colors[], int numLeds, int loopCount);
+
+// Helper function that times drawing FRAMES frames with each of the
+// count draw functions, taking turns for ROUNDS rounds, and puts the
+// best time of each in nanos, in ns per frame.  The best round is the
+// one least disturbed by the rest of the host, and taking turns keeps
+// the host from favouring whichever function runs first.
+static void bestNanos(const DrawFunction draw[], unsigned char count, double nanos[]) {
+  CRGB colors[LAYOUT_LEDS];
+  unsigned long long best[4];
+  unsigned long check = 0;
+  for (unsigned char d = 0; d < count; d++) {
+    best[d] = ~0ULL;
+  }
+  for (unsigned int round = 0; round < ROUNDS; round++) {
+    for (unsigned char d = 0; d < count; d++) {
+      unsigned long long start = nowNanos();
+      for (unsigned int f = 0; f < FRAMES; f++) {
+        draw[d](colors, LAYOUT_LEDS, f);
+        check += colors[f % LAYOUT_LEDS].red;
+      }
+      unsigned long long elapsed = nowNanos() - start;
+      if (elapsed < best[d]) {
+        best[d] = elapsed;
+      }
+    }
+  }
+  for (unsigned char d = 0; d < count; d++) {
+    nanos[d] = (double)best[d] / FRAMES;
+  }
+  TEST_ASSERT_TRUE(check != 1);  // keeps the work from being optimized away
+}
+
+
+// The cost per frame of drawing the stacks in one pass, one pass per
+// layer, and the way they were (or would be) written without layers.
+void test_fused_against_sequential_cost() {
+  double nanos[3];
+  const DrawFunction gradients[] = {
+    [](CRGB c[], int n, int l) { gradient(c, n, l); },
+    [](CRGB c[], int n, int l) { sequentialGradient(c, n, l, 0); },
+    twoPassGradient
+  };
+  bestNanos(gradients, 3, nanos);
+  printf("Gradient (%d LEDs): one pass %.0f ns/frame, pass per layer %.0f ns/frame, "
+    "before the layers %.0f ns/frame\n", LAYOUT_LEDS, nanos[0], nanos[1], nanos[2]);
+
+  const DrawFunction layoutGradients[] = {
+    [](CRGB c[], int n, int l) { gradient(c, n, l, 1); },
+    [](CRGB c[], int n, int l) { sequentialGradient(c, n, l, 1); }
+  };
+  bestNanos(layoutGradients, 2, nanos);
+  printf("Gradient in layout order: one pass %.0f ns/frame, pass per layer %.0f ns/frame\n",
+    nanos[0], nanos[1]);
+
+  const DrawFunction stacks[] = { fusedStack, sequentialStack, handWrittenStack };
+  bestNanos(stacks, 3, nanos);
+  printf("twinkles over a masked gradient: one pass %.0f ns/frame, pass per layer %.0f ns/frame, "
+    "without layers %.0f ns/frame\n", nanos[0], nanos[1], nanos[2]);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fused_matches_two_pass_gradient);
+  RUN_TEST(test_fused_matches_sequential_layers);
+  RUN_TEST(test_stack_matches_sequential_layers);
+  RUN_TEST(test_layers_do_what_they_say);
+  RUN_TEST(test_fused_against_sequential_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,278 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <unity.h>
+#include "constants.h"
+#include "layers.h"
+#include "layout.h"
+#include "patterns.h"
+#include "prng.h"
+
+// Checks of the layout tables (src/layout.h) and the Gradient layers
+// that scroll along them, and a comparison of the cost of following the
+// layout through the tables with the code paths that do without them.
+
+// src/layout_table.h is generated by: layout.py cone --leds 60 --turns 5
+const int LAYOUT_LEDS = 60;
+const float CONE_TURNS = 5;
+const float SPIRAL_TURNS = 3;
+const int MATRIX_WIDTH = 10;
+const unsigned int FRAMES = 2000;
+
+struct Point {
+  float x;
+  float y;
+  float z;
+};
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// cone() in tools/layout.py
+static Point conePoint(int i, int n) {
+  float t = (float)i / (n - 1);
+  float angle = 2 * (float)M_PI * CONE_TURNS * t;
+  float radius = 1.0f - 0.9f * t;
+  Point p = { radius * cosf(angle), radius * sinf(angle), t };
+  return p;
+}
+
+
+// height of LED i in spiral() in tools/layout.py
+static float spiralHeight(int i, int n) {
+  float t = (float)i / (n - 1);
+  float angle = 2 * (float)M_PI * SPIRAL_TURNS * t;
+  float radius = 1.0f - 0.9f * t;
+  return 0.5f + 0.5f * radius * sinf(angle);
+}
+
+
+// height of LED i in matrix() in tools/layout.py
+static float matrixHeight(int i, int n) {
+  int rows = (n + MATRIX_WIDTH - 1) / MATRIX_WIDTH;
+  return (float)(i / MATRIX_WIDTH) / (rows - 1);
+}
+
+
+// Helper function that fills positions with the scroll positions
+// tools/layout.py generates for the given heights (0 to 1).
+static void scrollPositions(float (*height)(int, int), int n, uint8_t positions[]) {
+  for (int i = 0; i < n; i++) {
+    long h = lroundf(255 * height(i, n));
+    positions[i] = (h * (n - 1) + 127) / 255;
+  }
+}
+
+
+static float distance(const Point &a, const Point &b) {
+  return sqrtf((a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y) + (a.z - b.z)*(a.z - b.z));
+}
+
+
+// neighbours() in tools/layout.py: the LAYOUT_NUM_NEIGHBOURS closest
+// LEDs that are not next to LED i on the strip, within 1.8 times the
+// median spacing of the LEDs
+static void coneNeighbours(const Point points[], int n, uint8_t result[][LAYOUT_NUM_NEIGHBOURS]) {
+  float spacing[LAYOUT_LEDS];
+  for (int i = 0; i + 1 < n; i++) {
+    spacing[i] = distance(points[i], points[i + 1]);
+  }
+  std::sort(spacing, spacing + n - 1);
+  float limit = 1.8f * spacing[(n - 1) / 2];
+
+  for (int i = 0; i < n; i++) {
+    float best[LAYOUT_NUM_NEIGHBOURS];
+    for (uint8_t k = 0; k < LAYOUT_NUM_NEIGHBOURS; k++) {
+      result[i][k] = LAYOUT_NO_NEIGHBOUR;
+      best[k] = limit;
+    }
+    for (int j = 0; j < n; j++) {
+      if (abs(i - j) <= 1) {
+        continue;
+      }
+      float d = distance(points[i], points[j]);
+      for (uint8_t k = 0; k < LAYOUT_NUM_NEIGHBOURS; k++) {
+        if (d < best[k] || (d == best[k] && result[i][k] == LAYOUT_NO_NEIGHBOUR)) {
+          // insert j here and move the farther ones down
+          for (uint8_t m = LAYOUT_NUM_NEIGHBOURS - 1; m > k; m--) {
+            best[m] = best[m - 1];
+            result[i][m] = result[i][m - 1];
+          }
+          best[k] = d;
+          result[i][k] = j;
+          break;
+        }
+      }
+    }
+  }
+}
+
+
+static void gradientLayers(CRGB colors[], int numLeds, int loopCount, const uint8_t *positions) {
+  composite(colors, numLeds, makeStack(
+    GradientLayer(numLeds, loopCount, positions),
+    DimWaveLayer(numLeds, loopCount, positions)));
+}
+
+
+void setUp() {
+  TEST_ASSERT_TRUE(layoutMatches(LAYOUT_LEDS));
+}
+
+
+void tearDown() {
+}
+
+
+void test_gradient_follows_height() {
+  // a spiral goes up and down as it winds, and a matrix has whole rows
+  // at the same height, so neither map keeps the strip order
+  uint8_t spiral[LAYOUT_LEDS];
+  uint8_t matrix[LAYOUT_LEDS];
+  scrollPositions(spiralHeight, LAYOUT_LEDS, spiral);
+  scrollPositions(matrixHeight, LAYOUT_LEDS, matrix);
+  TEST_ASSERT_FALSE(std::is_sorted(spiral, spiral + LAYOUT_LEDS));
+  TEST_ASSERT_EQUAL(matrix[0], matrix[MATRIX_WIDTH - 1]);
+
+  // with a map, each LED shows what the LED at its position shows
+  // without one
+  const uint8_t *maps[] = { spiral, matrix };
+  CRGB strip[LAYOUT_LEDS];
+  CRGB mapped[LAYOUT_LEDS];
+  for (unsigned char m = 0; m < 2; m++) {
+    for (int loopCount = 0; loopCount < 250; loopCount++) {
+      gradientLayers(strip, LAYOUT_LEDS, loopCount, NULL);
+      gradientLayers(mapped, LAYOUT_LEDS, loopCount, maps[m]);
+      for (int i = 0; i < LAYOUT_LEDS; i++) {
+        TEST_ASSERT_TRUE(mapped[i] == strip[maps[m][i]]);
+      }
+    }
+  }
+
+  // and gradient() with the layout uses the checked-in table's map
+  CRGB layout[LAYOUT_LEDS];
+  for (int loopCount = 0; loopCount < 250; loopCount++) {
+    gradient(layout, LAYOUT_LEDS, loopCount, 1);
+    gradientLayers(mapped, LAYOUT_LEDS, loopCount, layoutScrollMap());
+    for (int i = 0; i < LAYOUT_LEDS; i++) {
+      TEST_ASSERT_TRUE(layout[i] == mapped[i]);
+    }
+  }
+}
+
+
+void test_tables_match_the_shape() {
+  Point points[LAYOUT_LEDS];
+  float radial[LAYOUT_LEDS];
+  float maxRadial = 0;
+  for (int i = 0; i < LAYOUT_LEDS; i++) {
+    points[i] = conePoint(i, LAYOUT_LEDS);
+    radial[i] = hypotf(points[i].x, points[i].y);
+    maxRadial = std::max(maxRadial, radial[i]);
+  }
+  for (int i = 0; i < LAYOUT_LEDS; i++) {
+    LedPosition p = layoutPosition(i);
+    TEST_ASSERT_INT_WITHIN(1, lroundf(127 * points[i].x), p.x);
+    TEST_ASSERT_INT_WITHIN(1, lroundf(127 * points[i].y), p.y);
+    TEST_ASSERT_INT_WITHIN(1, lroundf(255 * points[i].z), p.z);
+    TEST_ASSERT_EQUAL((p.z * (LAYOUT_LEDS - 1) + 127) / 255, pgm_read_byte(&layoutScrollMap()[i]));
+    TEST_ASSERT_INT_WITHIN(1, lroundf(255 * radial[i] / maxRadial), layoutRadialDistance(i));
+  }
+
+  // the height order holds every LED once, from the lowest up
+  bool seen[LAYOUT_LEDS] = { false };
+  for (int rank = 0; rank < LAYOUT_LEDS; rank++) {
+    uint8_t led = layoutLedAtHeight(rank);
+    TEST_ASSERT_LESS_THAN(LAYOUT_LEDS, led);
+    TEST_ASSERT_FALSE(seen[led]);
+    seen[led] = true;
+    if (rank > 0) {
+      TEST_ASSERT_TRUE(layoutPosition(led).z >= layoutPosition(layoutLedAtHeight(rank - 1)).z);
+    }
+  }
+
+  uint8_t neighbours[LAYOUT_LEDS][LAYOUT_NUM_NEIGHBOURS];
+  coneNeighbours(points, LAYOUT_LEDS, neighbours);
+  for (int i = 0; i < LAYOUT_LEDS; i++) {
+    for (uint8_t k = 0; k < LAYOUT_NUM_NEIGHBOURS; k++) {
+      TEST_ASSERT_EQUAL(layoutNeighbour(i, k), neighbours[i][k]);
+    }
+  }
+}
+
+
+// The cost per frame of the patterns that follow the layout, against
+// the code they run without it, and against working the position of
+// each LED out every frame: scaling its height from the position table
+// (as Gradient did before the scroll map) or from the shape itself.
+void test_layout_cost() {
+  CRGB colors[LAYOUT_LEDS];
+  uint8_t positions[LAYOUT_LEDS];
+  unsigned long long stripNanos = 0;
+  unsigned long long tableNanos = 0;
+  unsigned long long scaledNanos = 0;
+  unsigned long long shapeNanos = 0;
+  unsigned long check = 0;
+  for (unsigned int f = 0; f < FRAMES; f++) {
+    unsigned long long start = nowNanos();
+    gradient(colors, LAYOUT_LEDS, f, 0);
+    stripNanos += nowNanos() - start;
+    check += colors[f % LAYOUT_LEDS].red;
+
+    start = nowNanos();
+    gradient(colors, LAYOUT_LEDS, f, 1);
+    tableNanos += nowNanos() - start;
+    check += colors[f % LAYOUT_LEDS].red;
+
+    start = nowNanos();
+    for (int i = 0; i < LAYOUT_LEDS; i++) {
+      positions[i] = ((long)layoutPosition(i).z * (LAYOUT_LEDS - 1) + 127) / 255;
+    }
+    gradientLayers(colors, LAYOUT_LEDS, f, positions);
+    scaledNanos += nowNanos() - start;
+    check += colors[f % LAYOUT_LEDS].red;
+
+    start = nowNanos();
+    scrollPositions(spiralHeight, LAYOUT_LEDS, positions);
+    gradientLayers(colors, LAYOUT_LEDS, f, positions);
+    shapeNanos += nowNanos() - start;
+    check += colors[f % LAYOUT_LEDS].red;
+  }
+  printf("Gradient per frame: strip order %.0f ns, scroll map %.0f ns, "
+    "height scaled per LED %.0f ns, height from the shape %.0f ns\n",
+    (double)stripNanos / FRAMES, (double)tableNanos / FRAMES,
+    (double)scaledNanos / FRAMES, (double)shapeNanos / FRAMES);
+
+  for (unsigned char useLayout = 0; useLayout < 2; useLayout++) {
+    for (int i = 0; i < LAYOUT_LEDS; i++) {
+      colors[i] = CRGB(0, 0, 0);
+    }
+    prngSeed(1);
+    unsigned long long nanos = 0;
+    for (unsigned int f = 0; f < FRAMES; f++) {
+      unsigned long long start = nowNanos();
+      colorExplosion(0, colors, LAYOUT_LEDS, 1, useLayout);
+      nanos += nowNanos() - start;
+      check += colors[f % LAYOUT_LEDS].green;
+    }
+    printf("ColorExplosion per frame, %s: %.0f ns\n",
+      useLayout ? "with the neighbour table" : "strip neighbours only", (double)nanos / FRAMES);
+  }
+  TEST_ASSERT_TRUE(check != 1);  // keeps the work from being optimized away
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_gradient_follows_height);
+  RUN_TEST(test_tables_match_the_shape);
+  RUN_TEST(test_layout_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,226 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <time.h>
+#include <unity.h>
+#include "constants.h"
+#include "noise.h"
+#include "patterns.h"
+#include "prng.h"
+
+// Checks of the coherent noise (src/noise.h) that WarmWhiteShimmer and
+// RandomColorWalk walk by, and a comparison of their cost per frame
+// with the reseed-and-replay random walks they used before.
+
+const unsigned int ROUNDS = 200;  // the cost is the best of ROUNDS rounds
+const unsigned int FRAMES = 100;  // frames per round
+const uint8_t STEP = 8;  // noise time per frame in both patterns
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// The patterns before the noise: showPattern() reseeded the PRNG every
+// frame with a seed it changed every sixth frame, so each random walk
+// repeated its direction for six frames.
+static unsigned int replaySeed;
+
+static void replayReseed(unsigned int loopCount) {
+  if (loopCount % 6 == 0) {
+    replaySeed = prngRandom(30000);
+  }
+  prngSeed(replaySeed);
+}
+
+
+static void replayWarmWhiteShimmer(CRGB colors[], int numLeds, unsigned int loopCount) {
+  const unsigned char maxBrightness = 120;
+  const unsigned char changeAmount = 2;
+  replayReseed(loopCount);
+  for (int i = 0; i < numLeds; i += 2) {
+    randomWalk(&colors[i].red, maxBrightness, changeAmount, 2);
+    colors[i].green = colors[i].red*4/5;
+    colors[i].blue = colors[i].red >> 3;
+    if (i + 1 < numLeds) {
+      colors[i+1] = CRGB(colors[i].red >> 2, colors[i].green >> 2, colors[i].blue >> 2);
+    }
+  }
+}
+
+
+static void replayRandomColorWalk(CRGB colors[], int numLeds, unsigned int loopCount) {
+  const unsigned char maxBrightness = 180;
+  const unsigned char changeAmount = 3;
+  replayReseed(loopCount);
+  unsigned char start = numLeds % 7 == 0 ? 3 : numLeds % 7 == 1 ? 0 : numLeds % 7 == 2 ? 1 : 2;
+  for (int i = start; i < numLeds; i+=7) {
+    randomWalk(&colors[i].red, maxBrightness, changeAmount, 3);
+    randomWalk(&colors[i].green, maxBrightness, changeAmount, 3);
+    randomWalk(&colors[i].blue, maxBrightness, changeAmount, 3);
+    if (i >= 1) {
+      colors[i-1] = CRGB(colors[i].red >> 2, colors[i].green >> 2, colors[i].blue >> 2);
+    }
+    if (i >= 2) {
+      colors[i-2] = CRGB(colors[i].red >> 3, colors[i].green >> 3, colors[i].blue >> 3);
+    }
+    if (i + 1 < numLeds) {
+      colors[i+1] = colors[i-1];
+    }
+    if (i + 2 < numLeds) {
+      colors[i+2] = colors[i-2];
+    }
+  }
+}
+
+
+void setUp() {
+}
+
+
+void tearDown() {
+}
+
+
+void test_changes_add_up_to_the_samples() {
+  // follow a few tracks, one of them past the end of the cache, past
+  // the 16-bit time wrap: the walk must never drift from the noise it
+  // follows
+  const uint16_t seed = 12345;
+  const uint16_t tracks[] = { 0, 1, NOISE_CACHE_TRACKS - 1, NOISE_CACHE_TRACKS + 3 };
+  NoiseCache cache = {};
+  int value[4];
+  int cachedValue[4];
+  for (unsigned char t = 0; t < 4; t++) {
+    value[t] = cachedValue[t] = noise8(seed, tracks[t], 0);
+  }
+  uint16_t time = 0;
+  for (unsigned long step = 1; step <= 3 * 65536UL / STEP; step++) {
+    time += STEP;
+    NoiseSampler sampler;
+    noiseSeek(&sampler, seed, time, STEP);
+    noiseFollow(&cache, &sampler);
+    for (unsigned char t = 0; t < 4; t++) {
+      value[t] += noiseChange(&sampler, tracks[t]);
+      cachedValue[t] += noiseChangeCached(&sampler, tracks[t], &cache);
+      TEST_ASSERT_EQUAL(noiseSample(&sampler, tracks[t]), value[t]);
+      TEST_ASSERT_EQUAL(value[t], cachedValue[t]);
+    }
+  }
+}
+
+
+void test_seeking_matches_following() {
+  // a pattern resumed at some loopCount walks the same noise as one
+  // that got there frame by frame
+  const uint16_t seed = 777;
+  NoiseCache cache = {};
+  for (uint16_t time = 0; time < 4096; time += STEP) {
+    NoiseSampler sampler;
+    noiseSeek(&sampler, seed, time, STEP);
+    noiseFollow(&cache, &sampler);
+    noiseChangeCached(&sampler, 5, &cache);
+    TEST_ASSERT_EQUAL(noise8(seed, 5, time), noiseSample(&sampler, 5));
+  }
+  // and a cache left by another seed or time gives the right change,
+  // whether or not the step crosses a whole time
+  const uint16_t times[] = { 3000, 4096 + STEP, 4096 + 2*STEP };
+  const uint16_t seeds[] = { seed + 1, seed, seed };
+  for (unsigned char k = 0; k < 3; k++) {
+    NoiseSampler sampler;
+    noiseSeek(&sampler, seeds[k], times[k], STEP);
+    noiseFollow(&cache, &sampler);
+    TEST_ASSERT_EQUAL(noiseChange(&sampler, 5), noiseChangeCached(&sampler, 5, &cache));
+  }
+}
+
+
+void test_noise_is_smooth() {
+  // with easing, one step of 8/256 of a whole time moves a track by at
+  // most a few levels
+  int largest = 0;
+  for (uint16_t track = 0; track < 64; track++) {
+    for (uint16_t time = STEP; time < 8192; time += STEP) {
+      NoiseSampler sampler;
+      noiseSeek(&sampler, 99, time, STEP);
+      int change = abs(noiseChange(&sampler, track));
+      if (change > largest) {
+        largest = change;
+      }
+    }
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(12, largest);
+}
+
+
+typedef void (*DrawFunction)(CRGB colors[], int numLeds, unsigned int loopCount);
+
+// Helper function that times drawing FRAMES frames with each of the
+// count draw functions, taking turns for ROUNDS rounds, and puts the
+// best time of each in nanos, in ns per frame.  Each function keeps its
+// own colors and carries on from the frame it got to, so the noise
+// crosses whole times as often as it does in the show.
+static void bestNanos(const DrawFunction draw[], unsigned char count, double nanos[]) {
+  CRGB colors[2][NUM_LEDS];
+  unsigned long long best[2];
+  unsigned long check = 0;
+  for (unsigned char d = 0; d < count; d++) {
+    best[d] = ~0ULL;
+    for (int i = 0; i < NUM_LEDS; i++) {
+      colors[d][i] = CRGB(60, 60, 60);
+    }
+  }
+  unsigned int loopCount = 0;
+  for (unsigned int round = 0; round < ROUNDS; round++) {
+    for (unsigned char d = 0; d < count; d++) {
+      unsigned long long start = nowNanos();
+      for (unsigned int f = 0; f < FRAMES; f++) {
+        draw[d](colors[d], NUM_LEDS, loopCount + f);
+        check += colors[d][f % NUM_LEDS].red;
+      }
+      unsigned long long elapsed = nowNanos() - start;
+      if (elapsed < best[d]) {
+        best[d] = elapsed;
+      }
+    }
+    loopCount += FRAMES;
+  }
+  for (unsigned char d = 0; d < count; d++) {
+    nanos[d] = (double)best[d] / FRAMES;
+  }
+  TEST_ASSERT_TRUE(check != 1);  // keeps the work from being optimized away
+}
+
+
+// The cost per frame of both patterns on the whole strip, walked by the
+// noise and by the reseed-and-replay random walks.
+void test_noise_against_reseed_and_replay() {
+  double nanos[2];
+  const DrawFunction shimmers[] = {
+    [](CRGB c[], int n, unsigned int l) { warmWhiteShimmer(0, c, n, l, 4242); },
+    replayWarmWhiteShimmer
+  };
+  bestNanos(shimmers, 2, nanos);
+  printf("WarmWhiteShimmer (%d LEDs): noise %.0f ns/frame, reseed and replay %.0f ns/frame\n",
+    NUM_LEDS, nanos[0], nanos[1]);
+
+  const DrawFunction walks[] = {
+    [](CRGB c[], int n, unsigned int l) { randomColorWalk(0, 0, c, n, l, 4242); },
+    replayRandomColorWalk
+  };
+  bestNanos(walks, 2, nanos);
+  printf("RandomColorWalk (%d LEDs): noise %.0f ns/frame, reseed and replay %.0f ns/frame\n",
+    NUM_LEDS, nanos[0], nanos[1]);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_changes_add_up_to_the_samples);
+  RUN_TEST(test_seeking_matches_following);
+  RUN_TEST(test_noise_is_smooth);
+  RUN_TEST(test_noise_against_reseed_and_replay);
+  return UNITY_END();
+}
@@ -0,0 +1,194 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <time.h>
+#include <unity.h>
+#include "constants.h"
+#include "output.h"
+#include "patterns.h"
+#include "prng.h"
+
+// Checks of the 16-bit patterns and the fused output pass (src/output.h),
+// and their cost per LED on this host.
+
+const unsigned int FRAMES = 2000;
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+void setUp() {
+  outputBegin(255, CRGB(255, 255, 255));
+}
+
+
+void tearDown() {
+}
+
+
+void test_gradient16_rounds_down_to_gradient() {
+  CRGB colors[NUM_LEDS];
+  CRGB16 colors16[NUM_LEDS];
+  for (unsigned char useLayout = 0; useLayout < 2; useLayout++) {
+    for (int loopCount = 0; loopCount < 250; loopCount++) {
+      gradient(colors, NUM_LEDS, loopCount, useLayout);
+      gradient16(colors16, NUM_LEDS, loopCount, useLayout);
+      for (int i = 0; i < NUM_LEDS; i++) {
+        TEST_ASSERT_EQUAL(colors[i].red, colors16[i].red >> 8);
+        TEST_ASSERT_EQUAL(colors[i].green, colors16[i].green >> 8);
+        TEST_ASSERT_EQUAL(colors[i].blue, colors16[i].blue >> 8);
+      }
+    }
+  }
+}
+
+
+void test_gradient16_keeps_the_dim_levels() {
+  // count the distinct levels below the fourth 8-bit step over a full
+  // scroll of the waves
+  unsigned char seen8[4] = { 0 };
+  static unsigned char seen16[4 << 8];
+  CRGB colors[NUM_LEDS];
+  CRGB16 colors16[NUM_LEDS];
+  for (int loopCount = 0; loopCount < 250; loopCount++) {
+    gradient(colors, NUM_LEDS, loopCount);
+    gradient16(colors16, NUM_LEDS, loopCount);
+    for (int i = 0; i < NUM_LEDS; i++) {
+      if (colors16[i].red > 0 && colors16[i].red < (4 << 8)) {
+        seen8[colors[i].red] = 1;
+        seen16[colors16[i].red] = 1;
+      }
+    }
+  }
+  unsigned int levels8 = 0;
+  unsigned int levels16 = 0;
+  for (unsigned int v = 0; v < sizeof(seen16); v++) {
+    levels8 += v < sizeof(seen8) && seen8[v];
+    levels16 += seen16[v];
+  }
+  printf("levels below 4/255: %u in 8 bits, %u in 16 bits\n", levels8, levels16);
+  TEST_ASSERT_GREATER_THAN(2 * levels8, levels16);
+}
+
+
+void test_fades16_keep_the_dim_levels() {
+  // the flashes of Collision fade the whole strip out; in 16 bits the
+  // fades pass through more of the dim levels, and take about as long
+  unsigned char seen8[4] = { 0 };
+  static unsigned char seen16[4 << 8];
+  CRGB colors[NUM_LEDS];
+  CRGB16 colors16[NUM_LEDS] = {};
+  for (int i = 0; i < NUM_LEDS; i++) {
+    colors[i] = CRGB(0, 0, 0);
+  }
+  prngSeed(3);
+  int frames8 = 0;
+  while (!collision(colors, NUM_LEDS, frames8++)) {
+    for (int i = 0; i < NUM_LEDS; i++) {
+      if (colors[i].red > 0 && colors[i].red < 4) {
+        seen8[colors[i].red] = 1;
+      }
+    }
+  }
+  prngSeed(3);
+  int frames16 = 0;
+  while (!collision16(colors16, NUM_LEDS, frames16++)) {
+    for (int i = 0; i < NUM_LEDS; i++) {
+      if (colors16[i].red > 0 && colors16[i].red < (4 << 8)) {
+        seen16[colors16[i].red] = 1;
+      }
+    }
+  }
+  unsigned int levels8 = 0;
+  unsigned int levels16 = 0;
+  for (unsigned int v = 0; v < sizeof(seen16); v++) {
+    levels8 += v < sizeof(seen8) && seen8[v];
+    levels16 += seen16[v];
+  }
+  printf("Collision: %d frames in 8 bits, %d in 16 bits; levels below 4/255: %u in 8 bits, %u in 16 bits\n",
+    frames8, frames16, levels8, levels16);
+  TEST_ASSERT_GREATER_THAN(2 * levels8, levels16);
+  TEST_ASSERT_INT_WITHIN(frames8 / 10, frames8, frames16);
+}
+
+
+void test_twinkle16_brightens_and_fades_like_twinkle() {
+  // one white twinkle on one LED: the same brightening levels, and a
+  // fade of the same length
+  CRGB colors[1] = { CRGB(0, 0, 0) };
+  CRGB16 colors16[1] = {};
+  prngSeed(9);
+  brightTwinkle(0, 1, 0, colors, 1, 1);
+  prngSeed(9);
+  brightTwinkle16(0, 1, 0, colors16, 1, 1);
+  int frames8 = 0;
+  int frames16 = 0;
+  for (int f = 0; f < 200; f++) {
+    if (colors[0].red % 2) {
+      TEST_ASSERT_EQUAL(colors[0].red, colors16[0].red >> 8);
+    }
+    frames8 += colors[0].red != 0;
+    frames16 += colors16[0].red != 0;
+    brightTwinkle(0, 1, 1, colors, 1, 1);
+    brightTwinkle16(0, 1, 1, colors16, 1, 1);
+  }
+  TEST_ASSERT_EQUAL(frames8, frames16);
+}
+
+
+void test_dithering_averages_between_steps() {
+  // a level halfway between two of the table's 8-bit entries, shown for
+  // 256 frames, averages to the interpolated gamma value
+  const uint16_t level = (20 << 8) | 128;
+  CRGB16 in[NUM_LEDS];
+  CRGB out[NUM_LEDS];
+  OutputResidual residual[NUM_LEDS] = {};
+  for (int i = 0; i < NUM_LEDS; i++) {
+    in[i].red = in[i].green = in[i].blue = level;
+  }
+  unsigned long sum = 0;
+  for (unsigned int f = 0; f < 256; f++) {
+    outputFrame16(in, out, residual, NUM_LEDS);
+    sum += out[0].red;
+  }
+  uint16_t linear = (242 + 270) / 2;  // entries 20 and 21 of the gamma table
+  unsigned long expected = (unsigned long)linear * 65025 >> 16;  // in 1/256ths of a step
+  TEST_ASSERT_UINT_WITHIN(256, expected, sum);
+}
+
+
+void test_cost_per_led() {
+  CRGB colors[NUM_LEDS];
+  CRGB16 colors16[NUM_LEDS];
+  CRGB out[NUM_LEDS];
+  OutputResidual residual[NUM_LEDS] = {};
+  unsigned long long nanos8 = 0;
+  unsigned long long nanos16 = 0;
+  for (unsigned int f = 0; f < FRAMES; f++) {
+    gradient(colors, NUM_LEDS, f % 250);
+    gradient16(colors16, NUM_LEDS, f % 250);
+    unsigned long long start = nowNanos();
+    outputFrame(colors, out, residual, NUM_LEDS);
+    nanos8 += nowNanos() - start;
+    start = nowNanos();
+    outputFrame16(colors16, out, residual, NUM_LEDS);
+    nanos16 += nowNanos() - start;
+  }
+  printf("outputFrame %.1f ns/LED, outputFrame16 %.1f ns/LED\n",
+    (double)nanos8 / FRAMES / NUM_LEDS, (double)nanos16 / FRAMES / NUM_LEDS);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_gradient16_rounds_down_to_gradient);
+  RUN_TEST(test_gradient16_keeps_the_dim_levels);
+  RUN_TEST(test_fades16_keep_the_dim_levels);
+  RUN_TEST(test_twinkle16_brightens_and_fades_like_twinkle);
+  RUN_TEST(test_dithering_averages_between_steps);
+  RUN_TEST(test_cost_per_led);
+  return UNITY_END();
+}
@@ -0,0 +1,169 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <time.h>
+#include <unity.h>
+#include "constants.h"
+#include "output.h"
+#include "power.h"
+
+// Replays every pattern from start to end through the output pass and
+// the power limiter the way loop() shows it, and checks the estimated
+// draw of every frame sent to the strip against POWER_BUDGET_MA.  The
+// replay runs on whichever path the build has; the limit on the 8-bit
+// path, below full brightness, is also checked directly.
+
+// show state and pattern code in main.cpp
+extern CRGB colors[];
+extern SHOW_STATE unsigned int loopCount;
+extern SHOW_STATE unsigned char pattern;
+extern SHOW_STATE unsigned int maxLoops;
+void startPattern();
+unsigned char patternAfter(unsigned char p);
+unsigned char showPattern(CRGB colors[], int numLeds);
+void showFrame();
+void setup();
+
+static unsigned long maxSentMilliamps;
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// the draw of a frame as sent: FastLED scales every channel by the
+// brightness while sending it
+static void measureFrame(const CRGB leds[], int numLeds, uint8_t brightness) {
+  unsigned long sum = 0;
+  for (int i = 0; i < numLeds; i++) {
+    for (unsigned char c = 0; c < 3; c++) {
+      sum += scale8(leds[i][c], brightness);
+    }
+  }
+  unsigned long milliamps = (unsigned long)numLeds * MA_IDLE_PER_LED + (sum * MA_PER_CHANNEL + 254) / 255;
+  if (milliamps > maxSentMilliamps) {
+    maxSentMilliamps = milliamps;
+  }
+}
+
+
+// Helper function that plays pattern p from its first frame to its
+// last and returns the number of frames.
+static unsigned long playPattern(unsigned char p) {
+  pattern = p;
+  startPattern();
+  unsigned long frames = 0;
+  do {
+    if (loopCount == 0) {
+      for (int i = 0; i < NUM_LEDS; i++) {
+        colors[i] = CRGB(0, 0, 0);
+      }
+    }
+    showPattern(colors, NUM_LEDS);
+    showFrame();
+    frames++;
+    loopCount++;
+  } while (loopCount < maxLoops);
+  return frames;
+}
+
+
+void setUp() {
+  maxSentMilliamps = 0;
+  powerResetStats();
+}
+
+
+void tearDown() {
+}
+
+
+void test_every_pattern_stays_within_budget() {
+  const unsigned char first = pattern;
+  unsigned char p = first;
+  do {
+    setUp();
+    unsigned long frames = playPattern(p);
+    printf("pattern %u: %lu frames, peak %lu mA before limiting, %lu mA sent, %u frames limited\n",
+      p, frames, powerPeakMilliamps(), maxSentMilliamps, powerLimitedFrames());
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, maxSentMilliamps);
+    p = patternAfter(p);
+  } while (p != first);
+}
+
+
+void test_collision_flash_is_limited() {
+  // Collision's full-white flashes are what the limiter is for: make
+  // sure the replay above really exercised it
+  playPattern(6);
+  TEST_ASSERT_GREATER_THAN(POWER_BUDGET_MA, powerPeakMilliamps());
+  TEST_ASSERT_GREATER_THAN(0, powerLimitedFrames());
+  TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, maxSentMilliamps);
+}
+
+
+void test_limit_below_full_brightness() {
+  // without HIGH_PRECISION_OUTPUT FastLED is set to BRIGHTNESS and the
+  // sum is taken from the rendered colors: the limit must never raise
+  // the brightness, and must keep every level of white within budget
+  CRGB frame[NUM_LEDS];
+  for (unsigned int level = 0; level < 256; level += 5) {
+    for (int i = 0; i < NUM_LEDS; i++) {
+      frame[i] = CRGB(level, level, i % 2 ? level : 0);
+    }
+    maxSentMilliamps = 0;
+    uint8_t brightness = powerLimit(powerChannelSum(frame, NUM_LEDS), NUM_LEDS, POWER_BUDGET_MA, BRIGHTNESS);
+    TEST_ASSERT_LESS_OR_EQUAL(BRIGHTNESS, brightness);
+    measureFrame(frame, NUM_LEDS, brightness);
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, maxSentMilliamps);
+    if (level == 0) {
+      TEST_ASSERT_EQUAL(BRIGHTNESS, brightness);
+    }
+  }
+}
+
+
+void test_limiter_cost_per_frame() {
+  CRGB out[NUM_LEDS];
+  OutputResidual residual[NUM_LEDS] = {};
+  for (int i = 0; i < NUM_LEDS; i++) {
+    colors[i] = CRGB(255, 255, 255);
+  }
+  const unsigned int frames = 20000;
+  unsigned long long outputNanos = 0;
+  unsigned long long limitNanos = 0;
+  unsigned long long sumNanos = 0;
+  uint8_t brightness = 0;
+  for (unsigned int f = 0; f < frames; f++) {
+    unsigned long long start = nowNanos();
+    outputFrame(colors, out, residual, NUM_LEDS);
+    unsigned long long middle = nowNanos();
+    brightness ^= powerLimit(outputChannelSum(), NUM_LEDS, POWER_BUDGET_MA);
+    unsigned long long end = nowNanos();
+    limitNanos += end - middle;
+    outputNanos += middle - start;
+
+    colors[f % NUM_LEDS].red ^= 1;  // so the sweep cannot be hoisted
+    start = nowNanos();
+    brightness ^= powerLimit(powerChannelSum(colors, NUM_LEDS), NUM_LEDS, POWER_BUDGET_MA, BRIGHTNESS);
+    sumNanos += nowNanos() - start;
+  }
+  printf("output pass %.0f ns/frame, powerLimit() %.0f ns/frame, "
+    "powerChannelSum() and powerLimit() on the 8-bit path %.0f ns/frame (%d LEDs)\n",
+    (double)outputNanos / frames, (double)limitNanos / frames, (double)sumNanos / frames, NUM_LEDS);
+  (void)brightness;
+}
+
+
+int main() {
+  setup();
+  nativeShowHook = measureFrame;
+  UNITY_BEGIN();
+  RUN_TEST(test_every_pattern_stays_within_budget);
+  RUN_TEST(test_collision_flash_is_limited);
+  RUN_TEST(test_limit_below_full_brightness);
+  RUN_TEST(test_limiter_cost_per_frame);
+  return UNITY_END();
+}
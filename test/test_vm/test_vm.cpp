@@ -0,0 +1,278 @@
+#include <Arduino.h>
+#include "FastLED.h"
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+#include "constants.h"
+#include "patterns.h"
+#include "prng.h"
+#include "vm.h"
+
+// Checks of the pattern VM (src/vm.h) and a benchmark of its overhead
+// against the same patterns written in C++.  Programs are loaded the
+// way the strip receives them, through vmPollSerial().
+
+const int LEDS = 60;
+const unsigned int FRAMES = 2000;
+
+
+static unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// sends program to the VM like tools/vmasm.py does and returns the
+// value vmPollSerial() returned; replies gets the bytes it sent back
+static unsigned char sendProgram(const unsigned char *program, unsigned char length,
+ unsigned char checksumError, uint8_t *replies, size_t *replyCount) {
+  unsigned char frame[VM_MAX_PROGRAM + 3];
+  unsigned char sum = 0;
+  frame[0] = 0xA5;
+  frame[1] = length;
+  for (unsigned char i = 0; i < length; i++) {
+    frame[2 + i] = program[i];
+    sum += program[i];
+  }
+  frame[2 + length] = sum + checksumError;
+  nativeSerialCapture(1);
+  nativeSerialReceive(frame, length + 3);
+  unsigned char loaded = vmPollSerial();
+  *replyCount = nativeSerialTake(replies, 16);
+  nativeSerialCapture(0);
+  return loaded;
+}
+
+
+static void loadProgram(const unsigned char *program, unsigned char length) {
+  uint8_t replies[16];
+  size_t replyCount;
+  TEST_ASSERT_EQUAL(1, sendProgram(program, length, 0, replies, &replyCount));
+}
+
+
+void setUp() {
+  while (Serial.available()) {
+    Serial.read();
+  }
+}
+
+
+void tearDown() {
+}
+
+
+void test_serial_frame_is_acknowledged() {
+  const unsigned char program[] = { VM_EACH, VM_RGB, 1, 2, 3, VM_NEXT };
+  uint8_t replies[16];
+  size_t replyCount;
+  TEST_ASSERT_EQUAL(1, sendProgram(program, sizeof(program), 0, replies, &replyCount));
+  TEST_ASSERT_EQUAL(2, replyCount);
+  TEST_ASSERT_EQUAL(0x11, replies[0]);  // ready
+  TEST_ASSERT_EQUAL(0x06, replies[1]);  // loaded
+
+  CRGB colors[LEDS];
+  vmRun(colors, LEDS, 0);
+  TEST_ASSERT_TRUE(colors[LEDS - 1] == CRGB(1, 2, 3));
+}
+
+
+void test_bad_checksum_is_rejected() {
+  const unsigned char program[] = { VM_EACH, VM_RGB, 1, 2, 3, VM_NEXT };
+  const unsigned char bad[] = { VM_EACH, VM_RGB, 4, 5, 6, VM_NEXT };
+  loadProgram(program, sizeof(program));
+  uint8_t replies[16];
+  size_t replyCount;
+  TEST_ASSERT_EQUAL(0, sendProgram(bad, sizeof(bad), 1, replies, &replyCount));
+  TEST_ASSERT_EQUAL(2, replyCount);
+  TEST_ASSERT_EQUAL(0x15, replies[1]);
+
+  // the rejected program was received over the loaded one, which must
+  // be back in place
+  CRGB colors[LEDS];
+  vmRun(colors, LEDS, 0);
+  TEST_ASSERT_TRUE(colors[LEDS - 1] == CRGB(1, 2, 3));
+}
+
+
+void test_truncated_frame_times_out() {
+  const unsigned char partial[] = { 0xA5, 10, VM_EACH, VM_NEXT };
+  nativeSerialCapture(1);
+  nativeSerialReceive(partial, sizeof(partial));
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(0, vmPollSerial());
+  TEST_ASSERT_GREATER_OR_EQUAL(VM_RX_TIMEOUT_MS, millis() - start);
+  uint8_t replies[16];
+  TEST_ASSERT_EQUAL(2, nativeSerialTake(replies, 16));
+  TEST_ASSERT_EQUAL(0x15, replies[1]);
+  nativeSerialCapture(0);
+}
+
+
+void test_max_size_program_is_received() {
+  // a program as long as VM_MAX_PROGRAM: twice the UART buffer of an Uno
+  unsigned char program[VM_MAX_PROGRAM];
+  for (unsigned char i = 0; i < VM_MAX_PROGRAM; i += 2) {
+    program[i] = VM_DIM;
+    program[i + 1] = 1;
+  }
+  loadProgram(program, VM_MAX_PROGRAM);
+}
+
+
+void test_dim_shift_is_masked() {
+  const unsigned char program[] = { VM_EACH, VM_RGB, 200, 100, 50, VM_DIM, 9, VM_NEXT };
+  loadProgram(program, sizeof(program));
+  CRGB colors[LEDS];
+  vmRun(colors, LEDS, 0);
+  TEST_ASSERT_TRUE(colors[0] == CRGB(100, 50, 25));  // shifted by 9 & 7 = 1
+}
+
+
+void test_runaway_program_is_stopped_after_step_limit() {
+  // counts its passes through a loop that never ends into LED 0
+  const unsigned char program[] = {
+    VM_ADDI, 0, 1,
+    VM_PUT, 0, 0,
+    VM_JMP, 0xF8
+  };
+  loadProgram(program, sizeof(program));
+  CRGB colors[LEDS];
+  // three steps a pass, the PUT being the second of them
+  const unsigned int passes = (VM_STEP_LIMIT + 1) / 3;
+  for (unsigned char frame = 0; frame < 3; frame++) {
+    colors[0] = CRGB(0, 0, 0);
+    vmReset();
+    vmRun(colors, LEDS, frame);
+    TEST_ASSERT_EQUAL((unsigned char)passes, colors[0].red);
+  }
+}
+
+
+void test_bad_programs_are_bounded() {
+  // the costliest instruction at every step of the frame, and a loop
+  // over the strip that draws a random number per LED
+  const unsigned char walkForever[] = { VM_WALK, 7, 120, 2, 3, VM_JMP, 0xF9 };
+  const unsigned char pickForever[] = { VM_EACH, VM_PICK, VM_RND, 0, 8, VM_SEL, 0, VM_NEXT, VM_JMP, 0xF6 };
+  const unsigned char *programs[] = { walkForever, pickForever };
+  const unsigned char lengths[] = { sizeof(walkForever), sizeof(pickForever) };
+  CRGB colors[LEDS];
+  for (unsigned char p = 0; p < 2; p++) {
+    loadProgram(programs[p], lengths[p]);
+    // the same frame from the same seed, however the host is scheduled
+    CRGB first[LEDS];
+    for (unsigned char run = 0; run < 3; run++) {
+      for (int i = 0; i < LEDS; i++) {
+        colors[i] = CRGB(60, 60, 60);
+      }
+      vmReset();
+      prngSeed(7);
+      vmRun(colors, LEDS, 0);
+      if (run == 0) {
+        memcpy(first, colors, sizeof(first));
+      }
+      TEST_ASSERT_EQUAL_MEMORY(first, colors, sizeof(first));
+    }
+  }
+}
+
+
+// C++ versions of the benchmark programs below
+
+static void cppTwinkle(CRGB colors[], int numLeds) {
+  static const CRGB palette[3] = { CRGB(180, 0, 0), CRGB(0, 180, 0), CRGB(160, 120, 20) };
+  for (int i = 0; i < numLeds; i++) {
+    fade(&colors[i].red, 4);
+    fade(&colors[i].green, 4);
+    fade(&colors[i].blue, 4);
+  }
+  int led = prngRandom(numLeds);
+  colors[led] = palette[prngRandom(3)];
+}
+
+static void cppWalk(CRGB colors[], int numLeds) {
+  for (int i = 0; i < numLeds; i++) {
+    randomWalk(&colors[i].red, 120, 2, 3);
+    randomWalk(&colors[i].green, 120, 2, 3);
+    randomWalk(&colors[i].blue, 120, 2, 3);
+  }
+}
+
+static void cppRamp(CRGB colors[], int numLeds, unsigned int loopCount) {
+  for (int i = 0; i < numLeds; i++) {
+    colors[i].red = 4*i + loopCount;
+    colors[i].blue = colors[i].red + 128;
+  }
+}
+
+
+// Runs program and the C++ version for FRAMES frames from the same PRNG
+// seed, checks they render the same frames and prints the cost of each.
+static void benchmark(const char *name, const unsigned char *program, unsigned char length,
+ void (*cpp)(CRGB colors[], int numLeds, unsigned int loopCount)) {
+  loadProgram(program, length);
+  CRGB vmColors[LEDS];
+  CRGB cppColors[LEDS];
+  for (int i = 0; i < LEDS; i++) {
+    vmColors[i] = CRGB(0, 0, 0);
+    cppColors[i] = CRGB(0, 0, 0);
+  }
+  unsigned long long vmNanos = 0;
+  unsigned long long cppNanos = 0;
+  for (unsigned int f = 0; f < FRAMES; f++) {
+    prngSeed(f);
+    unsigned long long start = nowNanos();
+    vmRun(vmColors, LEDS, f);
+    vmNanos += nowNanos() - start;
+
+    prngSeed(f);
+    start = nowNanos();
+    cpp(cppColors, LEDS, f);
+    cppNanos += nowNanos() - start;
+    TEST_ASSERT_EQUAL_MEMORY(cppColors, vmColors, sizeof(vmColors));
+  }
+  printf("%-8s VM %6.0f ns/frame, C++ %6.0f ns/frame: %.1fx\n", name,
+    (double)vmNanos / FRAMES, (double)cppNanos / FRAMES, (double)vmNanos / cppNanos);
+}
+
+
+void test_overhead_against_cpp() {
+  // the default program: fade everything, light a random LED
+  const unsigned char twinkle[] = {
+    VM_PAL, 0, 180, 0, 0,
+    VM_PAL, 1, 0, 180, 0,
+    VM_PAL, 2, 160, 120, 20,
+    VM_EACH, VM_FADE, 7, 4, VM_NEXT,
+    VM_PICK, VM_RND, 0, 3, VM_PALR, 0
+  };
+  // every channel of every LED takes a random walk
+  const unsigned char walk[] = { VM_EACH, VM_WALK, 7, 120, 2, 3, VM_NEXT };
+  // register arithmetic only: a red/blue ramp scrolling with loopCount
+  const unsigned char ramp[] = {
+    VM_LDL, 1,
+    VM_EACH,
+    VM_LDX, 0, VM_ADD, 0, 0, VM_ADD, 0, 0, VM_ADD, 0, 1, VM_PUT, 0, 0,
+    VM_ADDI, 0, 128, VM_PUT, 2, 0,
+    VM_NEXT
+  };
+  benchmark("twinkle", twinkle, sizeof(twinkle),
+    [](CRGB colors[], int numLeds, unsigned int) { cppTwinkle(colors, numLeds); });
+  benchmark("walk", walk, sizeof(walk),
+    [](CRGB colors[], int numLeds, unsigned int) { cppWalk(colors, numLeds); });
+  benchmark("ramp", ramp, sizeof(ramp), cppRamp);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_serial_frame_is_acknowledged);
+  RUN_TEST(test_bad_checksum_is_rejected);
+  RUN_TEST(test_truncated_frame_times_out);
+  RUN_TEST(test_max_size_program_is_received);
+  RUN_TEST(test_dim_shift_is_masked);
+  RUN_TEST(test_runaway_program_is_stopped_after_step_limit);
+  RUN_TEST(test_bad_programs_are_bounded);
+  RUN_TEST(test_overhead_against_cpp);
+  return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Sends a test animation as Art-Net or E1.31 (sACN) DMX over UDP.
+
+Used to exercise the DMX_INGEST receiver (src/dmx.cpp), including its
+handling of lost and out-of-order packets, e.g. over loopback:
+
+    dmx_send.py --protocol artnet --leds 60 --fps 40 --seconds 10
+    dmx_send.py --protocol e131 --port 5568 --loss 0.05 --reorder 0.05
+
+At the end it prints how many packets it sent, skipped and reordered,
+to compare with the receiver's statistics.
+"""
+
+import argparse
+import colorsys
+import random
+import socket
+import struct
+import time
+import uuid
+
+CID = uuid.uuid4().bytes
+
+
+def artnet_packet(universe, sequence, data):
+    return (b"Art-Net\0" + struct.pack("<H", 0x5000) + struct.pack(">H", 14)
+            + bytes([sequence, 0]) + struct.pack("<H", universe)
+            + struct.pack(">H", len(data)) + data)
+
+
+def e131_packet(universe, sequence, data):
+    count = len(data) + 1  # property values include the start code
+    dmp = struct.pack(">HBBHHH", 0x7000 | (10 + count), 0x02, 0xA1, 0, 1, count) + b"\0" + data
+    framing = (struct.pack(">HI", 0x7000 | (77 + len(dmp)), 0x00000002)
+               + b"dmx_send.py".ljust(64, b"\0")
+               + struct.pack(">BHBBH", 100, 0, sequence, 0, universe)) + dmp
+    root = (struct.pack(">HH", 0x0010, 0) + b"ASC-E1.17\0\0\0"
+            + struct.pack(">HI", 0x7000 | (22 + len(framing)), 0x00000004) + CID) + framing
+    return root
+
+
+def frame(leds, t):
+    # a rainbow that scrolls along the strip
+    data = bytearray()
+    for i in range(leds):
+        r, g, b = colorsys.hsv_to_rgb((i / leds + t / 4) % 1.0, 1.0, 1.0)
+        data += bytes([int(255 * r), int(255 * g), int(255 * b)])
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=6454)
+    parser.add_argument("--protocol", choices=["artnet", "e131"], default="artnet")
+    parser.add_argument("--universe", type=int,
+                        help="default: the first universe, 0 for Art-Net and 1 for E1.31")
+    parser.add_argument("--leds", type=int, default=60)
+    parser.add_argument("--fps", type=float, default=40)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--loss", type=float, default=0.0, help="fraction of packets to skip")
+    parser.add_argument("--reorder", type=float, default=0.0, help="fraction of packets to send late")
+    args = parser.parse_args()
+    if args.universe is None:
+        args.universe = 0 if args.protocol == "artnet" else 1
+
+    make = artnet_packet if args.protocol == "artnet" else e131_packet
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sent = skipped = reordered = 0
+    held = None
+    sequence = 0
+    start = time.monotonic()
+    n = 0
+    while time.monotonic() - start < args.seconds:
+        if args.protocol == "artnet":
+            sequence = sequence % 255 + 1  # 1 to 255; 0 means unsequenced
+        else:
+            sequence = (sequence + 1) % 256
+        packet = make(args.universe, sequence, frame(args.leds, n / args.fps))
+        if random.random() < args.loss:
+            skipped += 1
+        elif held is None and random.random() < args.reorder:
+            held = packet  # send it after the next one
+            reordered += 1
+        else:
+            sock.sendto(packet, (args.host, args.port))
+            sent += 1
+            if held is not None:
+                sock.sendto(held, (args.host, args.port))
+                sent += 1
+                held = None
+        n += 1
+        time.sleep(max(0.0, start + n / args.fps - time.monotonic()))
+
+    if held is not None:
+        sock.sendto(held, (args.host, args.port))
+        sent += 1
+    print("sent %d, skipped %d, reordered %d" % (sent, skipped, reordered))
+
+
+if __name__ == "__main__":
+    main()
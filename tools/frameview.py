@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Shows the frames published by the FRAME_TAP frame tap (src/frametap.h).
+
+Run the native build with FRAME_TAP defined, then in another terminal:
+
+    frameview.py                      # live view in a true-color terminal
+    frameview.py --ppm out.ppm --frames 600
+
+The live view draws the strip as a row of colored cells, wrapped every
+--width LEDs. --ppm instead writes one row of pixels per frame, which
+shows how a pattern evolves over time. The viewer only ever reads the
+ring, so it cannot slow the producer down; if it falls more than the
+ring size behind, the producer counts the frames it missed as dropped.
+"""
+
+import argparse
+import mmap
+import os
+import signal
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<IHBBIII")  # FrameTapHeader
+SLOT = struct.Struct("<IIB3x")  # FrameTapSlot
+MAGIC = 0x5041544C
+READER_ATTACHED_OFFSET = 7
+READ_OFFSET = 12
+
+
+class Tap:
+    def __init__(self, name):
+        path = "/dev/shm/" + name.lstrip("/")
+        fd = os.open(path, os.O_RDWR)
+        try:
+            self.memory = mmap.mmap(fd, 0)
+        finally:
+            os.close(fd)
+        self.read = 0
+
+    def header(self):
+        """Returns (magic, numLeds, slots, written, dropped)."""
+        magic, num_leds, slots, _, written, _, dropped = HEADER.unpack_from(self.memory, 0)
+        return magic, num_leds, slots, written, dropped
+
+    def attach(self, attached):
+        self.memory[READER_ATTACHED_OFFSET] = 1 if attached else 0
+
+    def consume(self, frame):
+        self.read = frame
+        struct.pack_into("<I", self.memory, READ_OFFSET, frame & 0xFFFFFFFF)
+
+    def read_slot(self, frame, num_leds, slots):
+        """Returns (brightness, rgb bytes) of the frame, or None if it was
+        overwritten or is being written (the sequence lock check failed)."""
+        slot_size = SLOT.size + ((num_leds * 3 + 3) & ~3)
+        offset = HEADER.size + (frame % slots) * slot_size
+        sequence, number, brightness = SLOT.unpack_from(self.memory, offset)
+        if sequence & 1 or number != frame:
+            return None
+        start = offset + SLOT.size
+        rgb = self.memory[start:start + num_leds * 3]
+        if struct.unpack_from("<I", self.memory, offset)[0] != sequence:
+            return None
+        return brightness, rgb
+
+
+def scaled(rgb, brightness):
+    return bytes((c * brightness) >> 8 if brightness < 255 else c for c in rgb)
+
+
+def render(rgb, width):
+    lines = []
+    for row in range(0, len(rgb) // 3, width):
+        cells = []
+        for i in range(row, min(row + width, len(rgb) // 3)):
+            r, g, b = rgb[3 * i:3 * i + 3]
+            cells.append("\x1b[48;2;%d;%d;%dm  " % (r, g, b))
+        lines.append("".join(cells) + "\x1b[0m\x1b[K")
+    return "\n".join(lines)
+
+
+def interrupt(signum, frame):
+    raise KeyboardInterrupt
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--name", default="/ledstrip-frames", help="FRAME_TAP_NAME")
+    parser.add_argument("--width", type=int, default=60, help="LEDs per terminal row")
+    parser.add_argument("--ppm", help="write frames to this PPM image instead")
+    parser.add_argument("--frames", type=int, default=0,
+                        help="stop after this many frames (0: run until interrupted)")
+    args = parser.parse_args()
+
+    signal.signal(signal.SIGTERM, interrupt)  # detach when killed, too
+    tap = Tap(args.name)
+    tap.attach(True)
+    if not args.ppm:
+        sys.stdout.write("\x1b[2J")
+    shown = torn = 0
+    rows = []
+    try:
+        while args.frames == 0 or shown < args.frames:
+            magic, num_leds, slots, written, dropped = tap.header()
+            if magic != MAGIC or written == tap.read:
+                time.sleep(0.002)
+                continue
+            if written < tap.read or written - tap.read > slots:
+                # producer restarted, or the frames before these are gone
+                tap.read = max(0, written - slots)
+            latest = None
+            for frame in range(tap.read, written):
+                result = tap.read_slot(frame, num_leds, slots)
+                if result is None:
+                    torn += 1
+                    continue
+                brightness, rgb = result
+                latest = scaled(rgb, brightness)
+                if args.ppm:
+                    rows.append(latest)
+                shown += 1
+            tap.consume(written)
+            if latest is not None and not args.ppm:
+                sys.stdout.write("\x1b[H" + render(latest, args.width)
+                                 + "\nframe %d, dropped %d, torn %d\x1b[K\n"
+                                 % (written, dropped, torn))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        tap.attach(False)
+
+    if args.ppm and rows:
+        with open(args.ppm, "wb") as f:
+            f.write(b"P6\n%d %d\n255\n" % (len(rows[0]) // 3, len(rows)))
+            for row in rows:
+                f.write(row)
+    print("frames %d, torn %d, dropped by producer %d" % (shown, torn, tap.header()[4]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Generates src/layout_table.h, the physical LED layout used by src/layout.cpp.
+
+All the trigonometry, scaling, sorting and neighbour searches happen here,
+so the firmware only does table lookups.  Shapes:
+
+    cone     strip wound in a spiral around a cone (a tree), bottom to top
+    spiral   strip wound in a flat spiral (a wreath or frame), outside in
+    matrix   strip folded back and forth into rows (serpentine), bottom up
+
+Usage:
+    layout.py cone --leds 60 --turns 5 > src/layout_table.h
+    layout.py matrix --leds 60 --width 10 > src/layout_table.h
+"""
+
+import argparse
+import math
+
+NUM_NEIGHBOURS = 2  # LAYOUT_NUM_NEIGHBOURS in src/layout.h
+NO_NEIGHBOUR = 255
+
+
+def cone(n, turns):
+    points = []
+    for i in range(n):
+        t = i / max(n - 1, 1)
+        angle = 2 * math.pi * turns * t
+        radius = 1.0 - 0.9 * t  # narrows towards the top
+        points.append((radius * math.cos(angle), radius * math.sin(angle), t))
+    return points
+
+
+def spiral(n, turns):
+    points = []
+    for i in range(n):
+        t = i / max(n - 1, 1)
+        angle = 2 * math.pi * turns * t
+        radius = 1.0 - 0.9 * t
+        points.append((radius * math.cos(angle), radius * math.sin(angle), 0.5 + 0.5 * radius * math.sin(angle)))
+    return points
+
+
+def matrix(n, width):
+    rows = (n + width - 1) // width
+    points = []
+    for i in range(n):
+        row, col = divmod(i, width)
+        if row % 2:
+            col = width - 1 - col  # serpentine wiring
+        x = 2 * col / max(width - 1, 1) - 1
+        z = row / max(rows - 1, 1)
+        points.append((x, 0.0, z))
+    return points
+
+
+def neighbours(points):
+    # the physically closest LEDs that are not already next to each
+    # other on the strip, e.g. the LED on the turn above or below
+    spacing = sorted(math.dist(points[i], points[i + 1]) for i in range(len(points) - 1))
+    limit = 1.8 * spacing[len(spacing) // 2]
+    result = []
+    for i, p in enumerate(points):
+        near = sorted((math.dist(p, q), j) for j, q in enumerate(points) if abs(i - j) > 1)
+        near = [j for d, j in near if d <= limit][:NUM_NEIGHBOURS]
+        result.append(near + [NO_NEIGHBOUR] * (NUM_NEIGHBOURS - len(near)))
+    return result
+
+
+def rows(values, per_line=12):
+    return ",\n".join("  " + ", ".join(values[i:i + per_line]) for i in range(0, len(values), per_line))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("shape", choices=["cone", "spiral", "matrix"])
+    parser.add_argument("--leds", type=int, default=60)
+    parser.add_argument("--turns", type=float, default=5)
+    parser.add_argument("--width", type=int, default=10)
+    args = parser.parse_args()
+
+    if args.shape == "matrix":
+        points = matrix(args.leds, args.width)
+    else:
+        points = (cone if args.shape == "cone" else spiral)(args.leds, args.turns)
+
+    n = len(points)
+    heights = [round(255 * z) for x, y, z in points]
+    radial = [math.hypot(x, y) for x, y, z in points]
+    max_radial = max(radial) or 1
+    by_height = sorted(range(n), key=lambda i: (points[i][2], i))
+
+    print("// generated by tools/layout.py %s --leds %d --turns %g --width %d; do not edit"
+          % (args.shape, args.leds, args.turns, args.width))
+    print()
+    print("const int LAYOUT_NUM_LEDS = %d;" % n)
+    print()
+    print("// x, y (-127 to 127) and height (0 to 255) of each LED")
+    print("const LedPosition layoutPositions[LAYOUT_NUM_LEDS] PROGMEM = {")
+    print(rows(["{ %d, %d, %d }" % (round(127 * x), round(127 * y), h) for (x, y, z), h in zip(points, heights)], 4))
+    print("};")
+    print()
+    print("// height of each LED scaled to the strip (0 to LAYOUT_NUM_LEDS-1)")
+    print("const uint8_t layoutScrollPositions[LAYOUT_NUM_LEDS] PROGMEM = {")
+    print(rows([str((h * (n - 1) + 127) // 255) for h in heights]))
+    print("};")
+    print()
+    print("// distance of each LED from the center axis (0 to 255)")
+    print("const uint8_t layoutRadial[LAYOUT_NUM_LEDS] PROGMEM = {")
+    print(rows([str(round(255 * r / max_radial)) for r in radial]))
+    print("};")
+    print()
+    print("// LED indices sorted from lowest to highest")
+    print("const uint8_t layoutByHeight[LAYOUT_NUM_LEDS] PROGMEM = {")
+    print(rows([str(i) for i in by_height]))
+    print("};")
+    print()
+    print("// closest LEDs that are not next to each other on the strip (255: none)")
+    print("const uint8_t layoutNeighbours[LAYOUT_NUM_LEDS][LAYOUT_NUM_NEIGHBOURS] PROGMEM = {")
+    print(rows(["{ %s }" % ", ".join(str(j) for j in nb) for nb in neighbours(points)], 6))
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""Assembler for the pattern virtual machine in src/vm.h.
+
+Each line holds one instruction, a label definition ("name:") or
+nothing; comments start with ";".  Registers are written r0-r7,
+channel masks as a number or a combination of the letters r, g and b,
+and jump targets as labels.  Example:
+
+    EACH
+    FADE rgb 4
+    NEXT
+    PICK
+    RND r0 3
+    PALR r0
+
+Usage:
+    vmasm.py program.vasm               print the program as C bytes
+    vmasm.py program.vasm -o out.bin    write the raw program bytes
+    vmasm.py program.vasm --port PORT   send the program to the strip
+                                        (needs pyserial)
+
+Sending waits for the board to reboot (opening the port resets an Uno)
+and then for the strip to reply to each step of the frame, see
+vmPollSerial() in src/vm.h.
+"""
+
+import argparse
+import sys
+import time
+
+FRAME_START = 0xA5
+REPLY_READY = 0x11
+REPLY_OK = 0x06
+REPLY_BAD = 0x15
+BOOT_SECONDS = 2.5  # bootloader wait after the reset that opening the port causes
+MAX_PROGRAM = 128  # VM_MAX_PROGRAM in src/constants.h
+BAUD = 115200  # SERIAL_BAUD in src/constants.h
+
+# opcode and operand kinds, in the order of the VmOpcode enum;
+# kinds: r = register, i = immediate byte, m = channel mask,
+#        c = channel, l = label (relative jump)
+OPCODES = [
+    ("END", ""),
+    ("LDI", "ri"),
+    ("LDL", "r"),
+    ("LDX", "r"),
+    ("ADD", "rr"),
+    ("ADDI", "ri"),
+    ("MODI", "ri"),
+    ("RND", "ri"),
+    ("JNZ", "rl"),
+    ("JMP", "l"),
+    ("EACH", ""),
+    ("NEXT", ""),
+    ("PICK", ""),
+    ("SEL", "r"),
+    ("GET", "rc"),
+    ("PUT", "cr"),
+    ("FADE", "mi"),
+    ("WALK", "miii"),
+    ("RGB", "iii"),
+    ("PAL", "iiii"),
+    ("PALR", "r"),
+    ("BLEND", "ii"),
+    ("COPY", "i"),
+    ("DIM", "i"),
+]
+OPCODE_INDEX = {name: (i, kinds) for i, (name, kinds) in enumerate(OPCODES)}
+CHANNELS = {"r": 0, "red": 0, "g": 1, "green": 1, "b": 2, "blue": 2}
+
+
+class AsmError(Exception):
+    pass
+
+
+def parse_operand(kind, text, labels, next_pc):
+    if kind == "r":
+        if len(text) != 2 or text[0] != "r" or not "0" <= text[1] <= "7":
+            raise AsmError("expected a register r0-r7, got '%s'" % text)
+        return int(text[1])
+    if kind == "m" and text and all(ch in "rgb" for ch in text):
+        return sum(1 << CHANNELS[ch] for ch in set(text))
+    if kind == "c" and text in CHANNELS:
+        return CHANNELS[text]
+    if kind == "l":
+        if text not in labels:
+            raise AsmError("unknown label '%s'" % text)
+        offset = labels[text] - next_pc
+        if not -128 <= offset <= 127:
+            raise AsmError("jump to '%s' is too far" % text)
+        return offset & 0xFF
+    value = int(text, 0)
+    if not 0 <= value <= 255:
+        raise AsmError("value %d does not fit in a byte" % value)
+    return value
+
+
+def assemble(source):
+    # first pass: find instruction sizes and label addresses;
+    # second pass: encode
+    lines = []
+    labels = {}
+    pc = 0
+    for number, line in enumerate(source.splitlines(), 1):
+        line = line.split(";", 1)[0].strip()
+        while ":" in line:
+            label, line = line.split(":", 1)
+            labels[label.strip()] = pc
+            line = line.strip()
+        if not line:
+            continue
+        words = line.replace(",", " ").split()
+        name = words[0].upper()
+        if name not in OPCODE_INDEX:
+            raise AsmError("line %d: unknown instruction '%s'" % (number, words[0]))
+        opcode, kinds = OPCODE_INDEX[name]
+        if len(words) - 1 != len(kinds):
+            raise AsmError("line %d: %s takes %d operands" % (number, name, len(kinds)))
+        lines.append((number, opcode, kinds, words[1:]))
+        pc += 1 + len(kinds)
+
+    program = []
+    for number, opcode, kinds, operands in lines:
+        next_pc = len(program) + 1 + len(kinds)
+        program.append(opcode)
+        for kind, text in zip(kinds, operands):
+            try:
+                program.append(parse_operand(kind, text.lower(), labels, next_pc))
+            except (AsmError, ValueError) as e:
+                raise AsmError("line %d: %s" % (number, e))
+
+    if not program:
+        raise AsmError("empty program")
+    if len(program) > MAX_PROGRAM:
+        raise AsmError("program is %d bytes, max is %d" % (len(program), MAX_PROGRAM))
+    return bytes(program)
+
+
+def frame(program):
+    return bytes([FRAME_START, len(program)]) + program + bytes([sum(program) & 0xFF])
+
+
+def wait_reply(port, timeout):
+    """Returns the next reply byte, skipping any text the strip prints
+    (REPORT_STATS), or None if there is none within timeout seconds."""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        byte = port.read(1)
+        if byte and byte[0] in (REPLY_READY, REPLY_OK, REPLY_BAD):
+            return byte[0]
+    return None
+
+
+def send(port_name, program, attempts=3):
+    import serial
+    port = serial.Serial()
+    port.port = port_name
+    port.baudrate = BAUD
+    port.timeout = 0.05
+    port.dtr = False  # avoids the reset where the driver allows it
+    with port:
+        time.sleep(BOOT_SECONDS)  # and waits it out where it does not
+        data = frame(program)
+        for attempt in range(attempts):
+            port.reset_input_buffer()
+            port.write(data[:1])
+            # the strip checks for a frame once per loop, so the reply
+            # can take a frame or two
+            if wait_reply(port, 1.0) != REPLY_READY:
+                continue
+            port.write(data[1:])
+            reply = wait_reply(port, 1.0)
+            if reply == REPLY_OK:
+                return
+            time.sleep(0.2)  # let a partly received frame time out
+        raise SystemExit("%s: the strip did not accept the program" % port_name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("source")
+    parser.add_argument("-o", "--output", help="write the raw program bytes to this file")
+    parser.add_argument("--port", help="send the program over this serial port")
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        try:
+            program = assemble(f.read())
+        except AsmError as e:
+            sys.exit("%s: %s" % (args.source, e))
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(program)
+    elif args.port:
+        send(args.port, program)
+    else:
+        print(", ".join(str(b) for b in program))
+    print("%d bytes" % len(program), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()